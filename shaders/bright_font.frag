@@ -9,7 +9,9 @@ struct Material {
 };
 
 uniform Material material;
-uniform vec3 baseColor;
+
+#include "material_incl.frag"
+#include "instance_incl.frag"
 
 void main() {
     float distance = texture(material.diffuse, TexCoords).r;
@@ -17,5 +19,5 @@ void main() {
     float smoothWidth = fwidth(distance) * 0.5;
     float alpha = smoothstep(0.5 - smoothWidth, 0.5 + smoothWidth, distance);
 
-    color = vec4(baseColor, alpha);
+    color = vec4(instanceBaseColor(materialBaseColor.rgb), alpha * instanceAlpha());
 }
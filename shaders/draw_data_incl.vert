@@ -0,0 +1,54 @@
+#pragma once
+
+/* Per-draw data written by IndirectRenderer (src/indirect_renderer.h).
+   Indirect draws get the slot through baseInstance, other draws through
+   drawIdOffset. */
+layout (location = 3) in uint aDrawId;
+
+uniform samplerBuffer drawData;
+uniform int drawIdOffset;
+
+const int DRAW_DATA_TEXELS = 9;
+
+int drawSlot()
+{
+    return (int(aDrawId) + drawIdOffset) * DRAW_DATA_TEXELS;
+}
+
+mat4 drawModelMatrix()
+{
+    int base = drawSlot();
+    return mat4(texelFetch(drawData, base),
+                texelFetch(drawData, base + 1),
+                texelFetch(drawData, base + 2),
+                texelFetch(drawData, base + 3));
+}
+
+// x: material index, y: shininess, z/w: diffuse/specular layer (-1: none)
+vec4 drawParams()
+{
+    return texelFetch(drawData, drawSlot() + 4);
+}
+
+// Texture rects within their array layers, offset in xy and scale in zw
+vec4 drawDiffuseRect()
+{
+    return texelFetch(drawData, drawSlot() + 5);
+}
+
+vec4 drawSpecularRect()
+{
+    return texelFetch(drawData, drawSlot() + 6);
+}
+
+// Material color with the object's property block applied, alpha from tint
+vec4 drawColor()
+{
+    return texelFetch(drawData, drawSlot() + 7);
+}
+
+// Texture coordinate offset in xy
+vec4 drawUvOffset()
+{
+    return texelFetch(drawData, drawSlot() + 8);
+}
@@ -1,11 +1,11 @@
 #version 330 core
 
 in vec2 texCoords;
+flat in vec4 TextColor;
 
 out vec4 color;
 
 uniform sampler2D fontAtlas;
-uniform vec3 textColor;
 
 void main() {
     float distance = texture(fontAtlas, texCoords).r;
@@ -13,5 +13,5 @@ void main() {
     float smoothWidth = fwidth(distance) * 0.5;
     float alpha = smoothstep(0.5 - smoothWidth, 0.5 + smoothWidth, distance);
 
-    color = vec4(textColor, alpha);
+    color = vec4(TextColor.rgb, alpha * TextColor.a);
 }
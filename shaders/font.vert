@@ -3,11 +3,15 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
+#include "text_data_incl.vert"
+
 out vec2 texCoords;
+flat out vec4 TextColor;
 
-uniform mat4 model;
+uniform mat4 projection;
 
 void main() {
-     gl_Position = model * vec4(aPos, 1.0);
+     gl_Position = projection * textModelMatrix() * vec4(aPos, 1.0);
      texCoords = aTexCoords;
+     TextColor = textColor();
 }
@@ -0,0 +1,32 @@
+#pragma once
+
+// Per-object MaterialPropertyBlock (src/material.h). instanceColor replaces
+// the material color by its alpha, instanceTint multiplies the result.
+// With TEXT_BATCH the color was resolved by TextBatcher and comes from
+// text_batched.vert instead.
+#ifdef TEXT_BATCH
+flat in vec4 InstanceColor;
+
+vec3 instanceBaseColor(vec3 materialColor)
+{
+  return InstanceColor.rgb;
+}
+
+float instanceAlpha()
+{
+  return InstanceColor.a;
+}
+#else
+uniform vec4 instanceColor;
+uniform vec4 instanceTint;
+
+vec3 instanceBaseColor(vec3 materialColor)
+{
+  return mix(materialColor, instanceColor.rgb, instanceColor.a) * instanceTint.rgb;
+}
+
+float instanceAlpha()
+{
+  return instanceTint.a;
+}
+#endif
@@ -5,12 +5,13 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 
-// #include "light_incl.frag"
+#include "light_incl.frag"
+#include "material_incl.frag"
+#include "instance_incl.frag"
 
 struct Material {
   sampler2D diffuse;
   sampler2D specular;
-  float shininess;
 };
 
 uniform Material material;
@@ -20,9 +21,10 @@ void main()
   vec3 result = vec3(0.0);
   vec3 normal = normalize(Normal);
   vec3 viewDir = normalize(viewPos - FragPos);
-  vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords));
+  vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords)) *
+      instanceBaseColor(vec3(1.0));
   vec3 specularColor = vec3(texture(material.specular, TexCoords));
-  float shininess = material.shininess;
+  float shininess = materialShininess;
 
   for (int i = 0; i < numPointLights; ++i) {
     result += CalcPointLight(pointLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
@@ -31,7 +33,7 @@ void main()
     result += CalcSpotLight(spotLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
   }
   for (int i = 0; i < numDirLights; ++i) {
-    result += CalcDirLight(dirLights[i], normal, viewDir, diffuseColor, specularColor, shininess);
+    result += CalcDirLight(dirLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
   }
 
   FragColor = vec4(result, 1.0);
@@ -1,11 +1,13 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
+#include "octahedral_incl.vert"
+
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec2 instanceUvOffset;
 
 out vec3 Normal;
 out vec3 FragPos;
@@ -14,7 +16,7 @@ out vec2 TexCoords;
 void main()
 {
     gl_Position =  projection * view * model * vec4(aPos, 1.0);
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(transpose(inverse(model))) * vertexNormal();
     FragPos = vec3(model * vec4(aPos, 1.0));
-    TexCoords = aTexCoords;
+    TexCoords = aTexCoords + instanceUvOffset;
 }
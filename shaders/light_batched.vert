@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+#include "octahedral_incl.vert"
+#include "draw_data_incl.vert"
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+flat out vec4 MaterialParams;
+flat out vec4 DiffuseRect;
+flat out vec4 SpecularRect;
+flat out vec4 InstanceColor;
+
+void main()
+{
+    mat4 model = drawModelMatrix();
+    gl_Position =  projection * view * model * vec4(aPos, 1.0);
+    Normal = mat3(transpose(inverse(model))) * vertexNormal();
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords + drawUvOffset().xy;
+    MaterialParams = drawParams();
+    DiffuseRect = drawDiffuseRect();
+    SpecularRect = drawSpecularRect();
+    InstanceColor = drawColor();
+}
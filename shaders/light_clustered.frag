@@ -0,0 +1,34 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+flat in vec4 InstanceColor;
+
+#include "light_clustered_incl.frag"
+#include "material_incl.frag"
+
+struct Material {
+  sampler2D diffuse;
+  sampler2D specular;
+};
+
+uniform Material material;
+
+void main()
+{
+  vec3 normal = normalize(Normal);
+  vec3 viewDir = normalize(viewPos - FragPos);
+  vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords)) *
+      InstanceColor.rgb;
+  vec3 specularColor = vec3(texture(material.specular, TexCoords));
+  float shininess = materialShininess;
+
+  vec3 result = CalcClusteredLights(normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
+  for (int i = 0; i < numDirLights; ++i) {
+    result += CalcDirLight(dirLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
+  }
+
+  FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "light_incl.frag"
+
+// Keep in sync with LightClusters in src/light_clusters.h
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_TEXELS_PER_LIGHT 6
+
+// Per light: (position, cutOff), (direction, outerCutOff),
+// (ambient, constant), (diffuse, linear), (specular, quadratic),
+// (shadowIndex, unused)
+uniform samplerBuffer clusterLightData;
+// Per cluster: (offset, count) into clusterLightIndices
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+uniform float clusterNear;
+uniform float clusterFar;
+
+uniform mat4 projection;
+
+SpotLight FetchClusterLight(int index) {
+  int base = index * CLUSTER_TEXELS_PER_LIGHT;
+  vec4 t0 = texelFetch(clusterLightData, base);
+  vec4 t1 = texelFetch(clusterLightData, base + 1);
+  vec4 t2 = texelFetch(clusterLightData, base + 2);
+  vec4 t3 = texelFetch(clusterLightData, base + 3);
+  vec4 t4 = texelFetch(clusterLightData, base + 4);
+  vec4 t5 = texelFetch(clusterLightData, base + 5);
+
+  SpotLight light;
+  light.position = t0.xyz;
+  light.cutOff = t0.w;
+  light.direction = t1.xyz;
+  light.outerCutOff = t1.w;
+  light.ambient = t2.xyz;
+  light.constant = t2.w;
+  light.diffuse = t3.xyz;
+  light.linear = t3.w;
+  light.specular = t4.xyz;
+  light.quadratic = t4.w;
+  light.shadowIndex = int(t5.x);
+  return light;
+}
+
+int ClusterIndex(vec3 fragPos) {
+  vec4 viewSpace = view * vec4(fragPos, 1.0);
+  vec4 clip = projection * viewSpace;
+  vec2 ndc = clip.xy / clip.w;
+  float depth = -viewSpace.z;
+
+  int x = clamp(int((ndc.x * 0.5 + 0.5) * CLUSTER_GRID_X), 0, CLUSTER_GRID_X - 1);
+  int y = clamp(int((ndc.y * 0.5 + 0.5) * CLUSTER_GRID_Y), 0, CLUSTER_GRID_Y - 1);
+  int z = int(floor(log(depth / clusterNear) / log(clusterFar / clusterNear) * CLUSTER_GRID_Z));
+  z = clamp(z, 0, CLUSTER_GRID_Z - 1);
+
+  return (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+}
+
+// Point lights are encoded as spotlights with a cone covering everything
+vec3 CalcClusteredLights(vec3 normal, vec3 fragPos, vec3 viewDir,
+                         vec3 diffuseColor, vec3 specularColor, float shininess) {
+  vec3 result = vec3(0.0);
+  uvec2 range = texelFetch(clusterGrid, ClusterIndex(fragPos)).rg;
+
+  for (uint i = 0u; i < range.y; ++i) {
+    int lightIndex = int(texelFetch(clusterLightIndices, int(range.x + i)).r);
+    result += CalcSpotLight(FetchClusterLight(lightIndex), normal, fragPos, viewDir,
+                            diffuseColor, specularColor, shininess);
+  }
+  return result;
+}
@@ -0,0 +1,66 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+flat in vec4 MaterialParams;
+flat in vec4 DiffuseRect;
+flat in vec4 SpecularRect;
+flat in vec4 InstanceColor;
+
+#include "light_clustered_incl.frag"
+#include "material_incl.frag"
+
+// Used until the material's textures are packed into arrays
+struct Material {
+  sampler2D diffuse;
+  sampler2D specular;
+};
+
+struct LayeredMaterial {
+  sampler2DArray diffuse;
+  sampler2DArray specular;
+};
+
+uniform Material material;
+uniform LayeredMaterial layeredMaterial;
+
+// Tiles are wrapped by hand; gradients come from the unwrapped coordinates
+// so the seam doesn't drop to the smallest mip
+vec3 sampleLayer(sampler2DArray textures, float layer, vec4 rect)
+{
+  vec2 uv = rect.xy + fract(TexCoords) * rect.zw;
+  return vec3(textureGrad(textures, vec3(uv, layer),
+                          dFdx(TexCoords) * rect.zw, dFdy(TexCoords) * rect.zw));
+}
+
+void main()
+{
+  vec3 normal = normalize(Normal);
+  vec3 viewDir = normalize(viewPos - FragPos);
+
+  vec3 diffuseColor;
+  vec3 specularColor;
+  float shininess;
+  if (MaterialParams.z >= 0.0) {
+    diffuseColor = sampleLayer(layeredMaterial.diffuse, MaterialParams.z, DiffuseRect);
+    specularColor = MaterialParams.w >= 0.0
+        ? sampleLayer(layeredMaterial.specular, MaterialParams.w, SpecularRect)
+        : vec3(0.0);
+    shininess = MaterialParams.y;
+  } else {
+    diffuseColor = vec3(texture(material.diffuse, TexCoords));
+    specularColor = vec3(texture(material.specular, TexCoords));
+    shininess = materialShininess;
+  }
+
+  diffuseColor *= InstanceColor.rgb;
+
+  vec3 result = CalcClusteredLights(normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
+  for (int i = 0; i < numDirLights; ++i) {
+    result += CalcDirLight(dirLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
+  }
+
+  FragColor = vec4(result, 1.0);
+}
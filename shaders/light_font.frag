@@ -6,14 +6,15 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 
-// #include "light_incl.frag"
+#include "light_incl.frag"
+#include "material_incl.frag"
+#include "instance_incl.frag"
 
 struct Material {
   sampler2D diffuse;
 };
 
 uniform Material material;
-uniform vec3 baseColor;
 
 void main()
 {
@@ -25,7 +26,7 @@ void main()
   float smoothWidth = fwidth(distance) * 0.5;
   float alpha = smoothstep(0.5 - smoothWidth, 0.5 + smoothWidth, distance);
 
-  vec3 diffuseColor = baseColor;
+  vec3 diffuseColor = instanceBaseColor(materialBaseColor.rgb);
   vec3 specularColor = vec3(1.0);
   float shininess = 32.0;
 
@@ -36,8 +37,8 @@ void main()
     result += CalcSpotLight(spotLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
   }
   for (int i = 0; i < numDirLights; ++i) {
-    result += CalcDirLight(dirLights[i], normal, viewDir, diffuseColor, specularColor, shininess);
+    result += CalcDirLight(dirLights[i], normal, FragPos, viewDir, diffuseColor, specularColor, shininess);
   }
 
-  FragColor = vec4(result, alpha);
+  FragColor = vec4(result, alpha * instanceAlpha());
 }
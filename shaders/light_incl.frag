@@ -1,3 +1,5 @@
+#pragma once
+
 struct PointLight {
   vec3 position;
 
@@ -25,6 +27,7 @@ struct SpotLight {
   vec3 diffuse;
   vec3 specular;
 
+  int shadowIndex;
 };
 
 struct DirLight {
@@ -32,6 +35,8 @@ struct DirLight {
   vec3 ambient;
   vec3 diffuse;
   vec3 specular;
+
+  int shadowIndex;
 };
 
 #define MAX_POINT_LIGHTS 8
@@ -47,6 +52,49 @@ uniform SpotLight spotLights[MAX_SPOT_LIGHTS];
 uniform int numSpotLights;
 
 uniform vec3 viewPos;
+uniform mat4 view;
+
+// Keep in sync with ShadowRenderer in src/shadow_renderer.h
+#define NUM_SHADOW_CASCADES 3
+#define MAX_SPOT_SHADOWS 4
+
+// Matrices map world space straight to atlas texture coordinates
+uniform sampler2DShadow shadowAtlas;
+uniform mat4 dirShadowMatrices[NUM_SHADOW_CASCADES];
+uniform vec3 cascadeSplits;
+uniform mat4 spotShadowMatrices[MAX_SPOT_SHADOWS];
+
+float SampleShadow(mat4 shadowMatrix, vec3 fragPos, float bias) {
+  vec4 coords = shadowMatrix * vec4(fragPos, 1.0);
+  coords.xyz /= coords.w;
+  if (coords.z > 1.0) {
+    return 1.0;
+  }
+  return texture(shadowAtlas, vec3(coords.xy, coords.z - bias));
+}
+
+float ShadowBias(vec3 normal, vec3 lightDir) {
+  return max(0.002 * (1.0 - dot(normal, lightDir)), 0.0005);
+}
+
+float DirShadow(int shadowIndex, vec3 fragPos, vec3 normal, vec3 lightDir) {
+  if (shadowIndex < 0) {
+    return 1.0;
+  }
+  float depth = -(view * vec4(fragPos, 1.0)).z;
+  if (depth > cascadeSplits.z) {
+    return 1.0;
+  }
+  int cascade = depth < cascadeSplits.x ? 0 : (depth < cascadeSplits.y ? 1 : 2);
+  return SampleShadow(dirShadowMatrices[cascade], fragPos, ShadowBias(normal, lightDir));
+}
+
+float SpotShadow(int shadowIndex, vec3 fragPos, vec3 normal, vec3 lightDir) {
+  if (shadowIndex < 0) {
+    return 1.0;
+  }
+  return SampleShadow(spotShadowMatrices[shadowIndex], fragPos, ShadowBias(normal, lightDir));
+}
 
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos,
                     vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess) {
@@ -85,10 +133,12 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos,
   float distance = length(light.position - fragPos);
   float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
-  return attenuation * (ambient + intensity * (diffuse + specular));
+  float shadow = intensity > 0.0 ? SpotShadow(light.shadowIndex, fragPos, normal, lightDir) : 1.0;
+
+  return attenuation * (ambient + intensity * shadow * (diffuse + specular));
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir,
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 fragPos, vec3 viewDir,
                   vec3 diffuseColor, vec3 specularColor, float shininess) {
   vec3 lightDir = normalize(-light.direction);
 
@@ -101,5 +151,7 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir,
   float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
   vec3 specular = spec * light.specular * specularColor;
 
-  return ambient + diffuse + specular;
+  float shadow = DirShadow(light.shadowIndex, fragPos, normal, lightDir);
+
+  return ambient + shadow * (diffuse + specular);
 }
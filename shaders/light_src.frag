@@ -2,9 +2,10 @@
 
 out vec4 FragColor;
 
-uniform vec3 baseColor;
+#include "material_incl.frag"
+#include "instance_incl.frag"
 
 void main()
 {
-  FragColor = vec4(baseColor, 1.0F);
+  FragColor = vec4(instanceBaseColor(materialBaseColor.rgb), 1.0F);
 }
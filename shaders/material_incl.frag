@@ -0,0 +1,8 @@
+#pragma once
+
+// Written by Material through MaterialBuffer (src/material_buffer.h), one
+// range per material bound at MaterialBuffer::BINDING
+layout (std140) uniform MaterialBlock {
+  vec4 materialBaseColor;
+  float materialShininess;
+};
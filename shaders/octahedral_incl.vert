@@ -0,0 +1,29 @@
+#pragma once
+
+// Normal attribute of every vertex format. OCTAHEDRAL meshes store it
+// octahedral-encoded and need the shader built with OCT_NORMALS defined.
+#ifdef OCT_NORMALS
+layout (location = 1) in vec2 aNormal;
+#else
+layout (location = 1) in vec3 aNormal;
+#endif
+
+/* Inverse of octahedralEncode() in src/vertex_formats.cpp */
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
+
+vec3 vertexNormal()
+{
+#ifdef OCT_NORMALS
+    return octDecode(aNormal);
+#else
+    return aNormal;
+#endif
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/* Per-text data written by TextBatcher (src/text_batcher.h), indexed by
+   the text each glyph vertex belongs to. */
+layout (location = 3) in float aTextIndex;
+
+uniform samplerBuffer textData;
+
+const int TEXT_DATA_TEXELS = 5;
+
+int textSlot()
+{
+    return int(aTextIndex) * TEXT_DATA_TEXELS;
+}
+
+mat4 textModelMatrix()
+{
+    int base = textSlot();
+    return mat4(texelFetch(textData, base),
+                texelFetch(textData, base + 1),
+                texelFetch(textData, base + 2),
+                texelFetch(textData, base + 3));
+}
+
+// Final color, alpha multiplies the glyph coverage
+vec4 textColor()
+{
+    return texelFetch(textData, textSlot() + 4);
+}
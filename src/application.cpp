@@ -171,25 +171,32 @@ void Application::initGL() {
 }
 
 void Application::loadResources() {
-  resourceManager.loadShader("shader", "shaders/light.vert",
-                             "shaders/light.frag");
-
-  resourceManager.loadShader("lightSourceShader", "shaders/light.vert",
-                             "shaders/light_src.frag");
-
-  resourceManager.loadShader("fontShader", "shaders/font.vert",
-                             "shaders/font.frag");
-
-  resourceManager.loadShader("3dFontShader", "shaders/light.vert",
-                             "shaders/light_font.frag");
-
-  resourceManager.loadShader("3dBrightFontShader", "shaders/light.vert",
-                             "shaders/bright_font.frag");
-
+  resourceManager.setProgramCacheEnabled(true);
+  resourceManager.setShaderHotReloadEnabled(true);
+  resourceManager.loadShaders({
+      {"shader", "shaders/light.vert", "shaders/light.frag"},
+      {"clusteredShader", "shaders/light_batched.vert",
+       "shaders/light_clustered.frag"},
+      {"layeredShader", "shaders/light_batched.vert",
+       "shaders/light_clustered_layered.frag"},
+      {"layeredOctShader", "shaders/light_batched.vert",
+       "shaders/light_clustered_layered.frag", {{"OCT_NORMALS", ""}}},
+      {"lightSourceShader", "shaders/light.vert", "shaders/light_src.frag"},
+      {"shadowDepthShader", "shaders/shadow_depth.vert",
+       "shaders/shadow_depth.frag"},
+      {"fontShader", "shaders/font.vert", "shaders/font.frag"},
+      {"3dFontShader", "shaders/text_batched.vert", "shaders/light_font.frag",
+       {{"TEXT_BATCH", ""}}},
+      {"3dBrightFontShader", "shaders/text_batched.vert",
+       "shaders/bright_font.frag", {{"TEXT_BATCH", ""}}},
+  });
+
+  resourceManager.setTexturePackingEnabled(true);
+  resourceManager.setTextureStreamingEnabled(true);
   resourceManager.loadTexture("texture", "assets/container.jpg");
   resourceManager.loadTexture("container2", "assets/container2.png");
   resourceManager.loadTexture("container2_specular",
-                              "assets/container2_specular.png");
+                              "assets/container2_specular.png", false);
 
   resourceManager.loadFont("arial", "fonts/arial.ttf", 64);
   resourceManager.loadFont("shiny", "fonts/shiny.ttf", 64);
@@ -243,10 +250,17 @@ void Application::loadResources() {
   iota(indices.begin(), indices.end(), 0);
   LOG_INFO(indices[0], indices[1]);
 
-  resourceManager.loadMesh("cube", vertices, indices);
-
-  resourceManager.createMaterial("container2", "shader", "container2",
-                                 "container2_specular");
+  resourceManager.setMeshPoolEnabled(true);
+  /* The textured cubes get the octahedral normals, which only shaders
+     built with OCT_NORMALS decode */
+  resourceManager.loadMesh("octCube", vertices, indices,
+                           MeshResidency::GPU_ONLY, VertexFormat::OCTAHEDRAL);
+  resourceManager.loadMesh("cube", std::move(vertices), std::move(indices),
+                           MeshResidency::GPU_ONLY, VertexFormat::COMPACT);
+  resourceManager.logMeshMemoryReport();
+
+  resourceManager.createMaterial("container2", "layeredOctShader",
+                                 "container2", "container2_specular");
 }
 
 float Application::getAspectRatio() {
@@ -254,6 +268,7 @@ float Application::getAspectRatio() {
 }
 
 void Application::setupScene() {
+  scene.setShadowShader(resourceManager.getShader("shadowDepthShader"));
 
   std::unique_ptr<Camera> camera =
       std::make_unique<Camera>(glm::vec3(0.0f, 0.0f, 3.0f), getAspectRatio());
@@ -265,22 +280,24 @@ void Application::setupScene() {
       glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
       glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f)};
 
-  for (size_t i = 0; i < 10; i++) {
-    auto textMaterial =
-        std::make_shared<Material>(resourceManager.getShader("3dFontShader"),
-                                   resourceManager.getFont("arial"), nullptr);
-    textMaterial->setBaseColor(glm::vec3(1.0F));
-    textMaterial->setOpaque(false);
+  /* Shared by all texts so they batch; per-text colors go through
+     GameObject::setColor */
+  auto textMaterial =
+      std::make_shared<Material>(resourceManager.getShader("3dFontShader"),
+                                 resourceManager.getFont("arial"), nullptr);
+  textMaterial->setBaseColor(glm::vec3(1.0F));
+  textMaterial->setOpaque(false);
 
+  for (size_t i = 0; i < 10; i++) {
     auto text = std::make_unique<WorldText>(resourceManager.getFont("arial"),
-                                            std::move(textMaterial),
+                                            textMaterial,
                                             "Michał jest super :)");
     text->setName("text" + std::to_string(i));
     text->setScale(glm::vec3(0.001F));
     text->setPosition(glm::vec3(-0.25F, 0.0F, 0.501F));
 
     std::unique_ptr<GameObject> cube =
-        std::make_unique<GameObject>(resourceManager.getMesh("cube"),
+        std::make_unique<GameObject>(resourceManager.getMesh("octCube"),
                                      resourceManager.getMaterial("container2"));
     cube->setPosition(cubePositions[i]);
     cube->rotate(20.0F * i, glm::vec3(1.0F, 0.3F, 0.5F));
@@ -296,6 +313,7 @@ void Application::setupScene() {
   dirLight->setPosition(glm::vec3(0.0F, 0.0F, -200.0F));
   dirLight->setScale(glm::vec3(10.0));
   dirLight->faceDirection(glm::vec3(1.0F));
+  dirLight->setCastShadows(false);
 
   std::unique_ptr<DirectionalLightComponent> dirLightComponent =
       std::make_unique<DirectionalLightComponent>(
@@ -309,6 +327,7 @@ void Application::setupScene() {
       resourceManager.getMesh("cube"), pointLightMaterial);
   pointLight->setPosition(glm::vec3(1.0F, 1.4F, 1.3F));
   pointLight->setScale(glm::vec3(0.1));
+  pointLight->setCastShadows(false);
 
   std::unique_ptr<PointLightComponent> pointLightComponent =
       std::make_unique<PointLightComponent>();
@@ -333,6 +352,7 @@ void Application::setupScene() {
   spotLight->faceDirection(glm::vec3(0.0F, 0.0F, -1.0F));
   spotLight->setScale(glm::vec3(0.1F, 0.1F, 0.3F));
   spotLight->setPosition(glm::vec3(0.2F, -0.2F, -1.0F));
+  spotLight->setCastShadows(false);
   camera->addChild(std::move(spotLight));
 
   auto bannerMaterial = std::make_shared<Material>(
@@ -375,6 +395,8 @@ void Application::update() {
   lastFrame = currentFrame;
 
   processInput();
+  resourceManager.processTextureUploads();
+  resourceManager.processShaderReloads();
   scene.update(deltaTime);
 }
 
@@ -12,6 +12,8 @@ Camera::Camera(glm::vec3 position, float aspectRatio, glm::vec3 front,
       speed(speed),
       aspectRatio(aspectRatio),
       fov(fov),
+      nearPlane(0.1F),
+      farPlane(500.0F),
       worldUp(glm::normalize(up)),
       yaw(0.0f),
       pitch(0.0f) {
@@ -45,7 +47,8 @@ void Camera::updateMatrices() {
   glm::vec3 up = getUp();
   LOG_DEBUG("Updating matrices: ", getPosition(), front, up);
   view = glm::lookAt(getPosition(), getPosition() + front, up);
-  projection = glm::perspective(glm::radians(fov), aspectRatio, 0.1F, 500.0F);
+  projection = glm::perspective(glm::radians(fov), aspectRatio, nearPlane,
+                                farPlane);
 }
 
 void Camera::update(float deltaTime) {
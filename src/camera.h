@@ -13,6 +13,8 @@ class Camera : public GameObject {
   float speed;
   float aspectRatio;
   float fov;
+  float nearPlane;
+  float farPlane;
 
   glm::mat4 view;
   glm::mat4 projection;
@@ -46,6 +48,11 @@ class Camera : public GameObject {
   const glm::mat4& getViewMatrix() const { return view; }
   const glm::mat4& getProjectionMatrix() const { return projection; }
 
+  float getFov() const { return fov; }
+  float getAspectRatio() const { return aspectRatio; }
+  float getNearPlane() const { return nearPlane; }
+  float getFarPlane() const { return farPlane; }
+
   void setAspectRatio(float newAspectRatio) {
     LOG_DEBUG("Switching aspect ratio: ", newAspectRatio);
     aspectRatio = newAspectRatio;
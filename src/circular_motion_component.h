@@ -5,7 +5,7 @@
 
 #include "src/component.h"
 
-class CircularMotionComponent : public Component {
+class CircularMotionComponent final : public Component {
  private:
   glm::vec3 center;
   float radius;
@@ -22,8 +22,11 @@ class Component {
 
   virtual std::string getTypeName() const = 0;
 
+  /* Called when the owning GameObject enters or leaves a Scene */
+  virtual void onSceneChanged() {}
+
   bool isEnabled() const { return enabled; }
-  void setEnabled(bool e) { enabled = e; }
+  virtual void setEnabled(bool e) { enabled = e; }
 
   GameObject* getGameObject() const { return gameObject; }
 };
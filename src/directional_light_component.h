@@ -7,17 +7,22 @@
 #include "src/game_object.h"
 #include "src/light_component.h"
 
-class DirectionalLightComponent : public LightComponent {
+class DirectionalLightComponent final : public LightComponent {
  private:
   glm::vec3 direction;
+  bool castShadows;
+  /* Set by ShadowRenderer every frame, -1 if the light has no shadow map */
+  int shadowIndex;
 
   std::string getUniformArrayName() const override { return "dirLights"; }
 
  public:
   DirectionalLightComponent(glm::vec3 ambient, glm::vec3 diffuse,
                             glm::vec3 specular, glm::vec3 direction)
-      : LightComponent(ambient, diffuse, specular),
-        direction(glm::normalize(direction)) {}
+      : LightComponent(LightType::DIRECTIONAL, ambient, diffuse, specular),
+        direction(glm::normalize(direction)),
+        castShadows(true),
+        shadowIndex(-1) {}
 
   glm::vec3 getDirection() const {
     if (gameObject) {
@@ -30,6 +35,12 @@ class DirectionalLightComponent : public LightComponent {
 
   void setDirection(const glm::vec3& dir) { direction = glm::normalize(dir); }
 
+  bool getCastShadows() const { return castShadows; }
+  void setCastShadows(bool cast) { castShadows = cast; }
+
+  int getShadowIndex() const { return shadowIndex; }
+  void setShadowIndex(int idx) { shadowIndex = idx; }
+
   std::string getTypeName() const override { return "DirectionalLightComponent"; }
 
   void setUniforms(Shader* shader, int idx) override {
@@ -37,6 +48,7 @@ class DirectionalLightComponent : public LightComponent {
     shader->setUniform(makeUniformName(idx, "ambient"), getAmbient());
     shader->setUniform(makeUniformName(idx, "diffuse"), getDiffuse());
     shader->setUniform(makeUniformName(idx, "specular"), getSpecular());
+    shader->setUniform(makeUniformName(idx, "shadowIndex"), shadowIndex);
   }
 };
 
@@ -0,0 +1,87 @@
+#include "src/file_watcher.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "src/logger.h"
+
+FileWatcher::FileWatcher() : fd(-1) {
+#ifdef __linux__
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    LOG_WARNING("inotify unavailable, files won't be watched: ",
+                strerror(errno));
+  }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+  if (fd >= 0) {
+    close(fd);
+  }
+#endif
+}
+
+void FileWatcher::watch(const std::filesystem::path& file) {
+  std::filesystem::path normal = file.lexically_normal();
+  if (!isAvailable() || !files.insert(normal.string()).second) {
+    return;
+  }
+
+#ifdef __linux__
+  std::filesystem::path directory =
+      normal.has_parent_path() ? normal.parent_path() : ".";
+  for (const auto& [wd, watched] : directories) {
+    if (watched == directory) {
+      return;
+    }
+  }
+  int wd = inotify_add_watch(fd, directory.c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd < 0) {
+    LOG_WARNING("Cannot watch ", directory, ": ", strerror(errno));
+    return;
+  }
+  directories.emplace(wd, directory);
+#endif
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+  std::vector<std::filesystem::path> changed;
+#ifdef __linux__
+  if (!isAvailable()) {
+    return changed;
+  }
+
+  alignas(inotify_event) char buffer[4096];
+  std::unordered_set<std::string> seen;
+  while (true) {
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      /* EAGAIN: no more events queued */
+      break;
+    }
+    for (char* ptr = buffer; ptr < buffer + length;) {
+      const inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+      ptr += sizeof(inotify_event) + event->len;
+
+      auto directory = directories.find(event->wd);
+      if (directory == directories.end() || event->len == 0) {
+        continue;
+      }
+      std::filesystem::path path =
+          (directory->second / event->name).lexically_normal();
+      if (files.count(path.string()) && seen.insert(path.string()).second) {
+        changed.push_back(std::move(path));
+      }
+    }
+  }
+#endif
+  return changed;
+}
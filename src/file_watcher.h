@@ -0,0 +1,37 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/* Reports files that were written, using inotify on their directories so
+   editors that save by renaming a temporary file are caught too. Without
+   inotify (non-Linux builds) nothing is ever reported. */
+class FileWatcher {
+ private:
+  int fd;
+  /* inotify watch descriptor to the directory it watches */
+  std::unordered_map<int, std::filesystem::path> directories;
+  /* Normalized paths of the watched files */
+  std::unordered_set<std::string> files;
+
+ public:
+  FileWatcher();
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  bool isAvailable() const { return fd >= 0; }
+
+  void watch(const std::filesystem::path& file);
+
+  /* Watched files written since the last call, each listed once. Never
+     blocks. */
+  std::vector<std::filesystem::path> poll();
+};
+
+#endif /* FILE_WATCHER_H */
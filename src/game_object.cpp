@@ -19,10 +19,22 @@ GameObject::GameObject(std::shared_ptr<Mesh> mesh,
       localMatrix(1.0F),
       modelMatrix(1.0F),
       dirty(true),
-      parent(nullptr) {}
+      transformVersion(0),
+      castShadows(true),
+      lodLevel(0),
+      parent(nullptr),
+      scene(nullptr) {
+  if (this->mesh && this->material && this->material->getShader() &&
+      this->mesh->getVertexFormat() == VertexFormat::OCTAHEDRAL &&
+      !this->material->getShader()->getDefines().count("OCT_NORMALS")) {
+    LOG_WARNING("Octahedral mesh ", this->mesh->getName(),
+                " drawn with a shader not built with OCT_NORMALS");
+  }
+}
 
 void GameObject::markDirty() {
   dirty = true;
+  transformVersion++;
   for (auto& child : children) {
     child->markDirty();
   }
@@ -54,9 +66,37 @@ void GameObject::drawGeometry() {
     return;
   }
   LOG_DEBUG("Drawing geometry for object ", name, "(", id, ")");
-  material->getShader()->setUniform("model", getModelMatrix());
+  Shader* shader = material->getShader().get();
+  shader->setUniform("model", getModelMatrix());
+  /* Checked one by one, stages may drop the ones they don't read */
+  if (shader->hasUniform("instanceColor")) {
+    shader->setUniform("instanceColor", properties.colorOverride());
+  }
+  if (shader->hasUniform("instanceTint")) {
+    shader->setUniform("instanceTint", properties.tint);
+  }
+  if (shader->hasUniform("instanceUvOffset")) {
+    shader->setUniform("instanceUvOffset", properties.uvOffset);
+  }
   if (mesh) {
+    drawMesh();
+  }
+}
+
+void GameObject::drawDepth(Shader* shader) {
+  if (!mesh) {
+    return;
+  }
+  shader->setUniform("model", getModelMatrix());
+  drawMesh();
+}
+
+void GameObject::drawMesh() {
+  /* draw() may be overridden (TextMesh), only LOD chains need drawLod() */
+  if (lodLevel == 0) {
     mesh->draw();
+  } else {
+    mesh->drawLod(lodLevel);
   }
 }
 
@@ -89,6 +129,7 @@ GameObject* GameObject::addChild(std::unique_ptr<GameObject> child) {
   GameObject* childPtr = child.get();
   child->parent = this;
   child->markDirty();
+  child->setScene(scene);
   children.push_back(std::move(child));
   return childPtr;
 }
@@ -100,6 +141,7 @@ std::unique_ptr<GameObject> GameObject::removeChild(GameObject* child) {
       children.erase(it);
       removed->parent = nullptr;
       removed->markDirty();
+      removed->setScene(nullptr);
       return removed;
     }
   }
@@ -118,6 +160,20 @@ void GameObject::setParent(GameObject* newParent) {
   markDirty();
 }
 
+void GameObject::setScene(Scene* newScene) {
+  if (scene == newScene) {
+    return;
+  }
+
+  scene = newScene;
+  for (std::unique_ptr<Component>& component : components) {
+    component->onSceneChanged();
+  }
+  for (auto& child : children) {
+    child->setScene(newScene);
+  }
+}
+
 glm::vec3 GameObject::getWorldPosition() const {
   return glm::vec3(getModelMatrix()[3]);
 }
@@ -138,6 +194,21 @@ glm::vec3 GameObject::getWorldScale() const {
   return worldScale;
 }
 
+void GameObject::getWorldBoundingSphere(glm::vec3& center,
+                                        float& radius) const {
+  if (!mesh) {
+    center = getWorldPosition();
+    radius = 0.0F;
+    return;
+  }
+
+  const glm::mat4& worldMat = getModelMatrix();
+  center = glm::vec3(worldMat * glm::vec4(mesh->getBoundsCenter(), 1.0F));
+  glm::vec3 worldScale = getWorldScale();
+  radius = mesh->getBoundsRadius() *
+           glm::max(worldScale.x, glm::max(worldScale.y, worldScale.z));
+}
+
 glm::mat4 GameObject::getWorldMatrix() const {
   return getModelMatrix();
 }
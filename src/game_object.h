@@ -1,7 +1,10 @@
 #ifndef GAME_OBJECT_H
 #define GAME_OBJECT_H
 
+#include <bitset>
 #include <cstdint>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <typeindex>
 #include <unordered_map>
@@ -17,6 +20,77 @@
 #include "src/mesh.h"
 #include "src/shader.h"
 
+class Scene;
+
+constexpr size_t MAX_COMPONENT_TYPES = 64;
+
+/* Dense id of a concrete component type, assigned on first use */
+inline size_t componentTypeId(std::type_index type) {
+  static std::unordered_map<std::type_index, size_t> ids;
+  auto [it, inserted] = ids.try_emplace(type, ids.size());
+  if (it->second >= MAX_COMPONENT_TYPES) {
+    throw std::length_error("Too many component types, raise "
+                            "MAX_COMPONENT_TYPES");
+  }
+  return it->second;
+}
+
+/* Components are bucketed by their dynamic type, so lookups only work for
+   concrete types: getComponent<LightComponent>() could never find a
+   PointLightComponent. Requiring final turns such a lookup into a compile
+   error instead of a silent nullptr. */
+template <typename T>
+size_t componentTypeId() {
+  static_assert(std::is_base_of<Component, T>::value,
+                "T must inherit from Component");
+  static_assert(std::is_final<T>::value,
+                "Components are looked up by concrete type, T must be final");
+  static const size_t id = componentTypeId(std::type_index(typeid(T)));
+  return id;
+}
+
+/* Non-owning, non-allocating range over the components of one type */
+template <typename T>
+class ComponentView {
+ private:
+  const std::vector<std::unique_ptr<Component>>* components;
+  std::span<const size_t> indices;
+
+ public:
+  class Iterator {
+   private:
+    const std::vector<std::unique_ptr<Component>>* components;
+    const size_t* it;
+
+   public:
+    Iterator(const std::vector<std::unique_ptr<Component>>* components,
+             const size_t* it)
+        : components(components), it(it) {}
+
+    T* operator*() const { return static_cast<T*>((*components)[*it].get()); }
+    Iterator& operator++() {
+      ++it;
+      return *this;
+    }
+    bool operator==(const Iterator& other) const { return it == other.it; }
+  };
+
+  ComponentView(const std::vector<std::unique_ptr<Component>>* components,
+                std::span<const size_t> indices)
+      : components(components), indices(indices) {}
+
+  Iterator begin() const { return Iterator(components, indices.data()); }
+  Iterator end() const {
+    return Iterator(components, indices.data() + indices.size());
+  }
+
+  size_t size() const { return indices.size(); }
+  bool empty() const { return indices.empty(); }
+  T* operator[](size_t i) const {
+    return static_cast<T*>((*components)[indices[i]].get());
+  }
+};
+
 class GameObject {
  private:
   static uint64_t nextId;
@@ -29,6 +103,11 @@ class GameObject {
   std::shared_ptr<Mesh> mesh;
   std::shared_ptr<Material> material;
   std::vector<std::unique_ptr<Component>> components;
+  /* Concrete type id of each entry in components */
+  std::vector<size_t> componentTypes;
+  /* Positions in components, bucketed by concrete type id */
+  std::vector<std::vector<size_t>> componentIndices;
+  std::bitset<MAX_COMPONENT_TYPES> componentMask;
 
   glm::vec3 position;
   glm::quat rotation;
@@ -36,10 +115,19 @@ class GameObject {
   mutable glm::mat4 localMatrix;
   mutable glm::mat4 modelMatrix;
   mutable bool dirty;
+  /* Bumped on every transform change, unlike dirty it is never reset */
+  uint64_t transformVersion;
+  bool castShadows;
+  /* Level of detail picked by Scene for the current frame */
+  size_t lodLevel;
+  MaterialPropertyBlock properties;
 
   GameObject* parent;
   std::vector<std::unique_ptr<GameObject>> children;
 
+  /* Scene this object (transitively) belongs to, nullptr if detached */
+  Scene* scene;
+
   void updateModelMatrix() const;
   void markDirty();
 
@@ -62,30 +150,73 @@ class GameObject {
                   "T must inherit from Component");
 
     T* ptr = component.get();
+    /* Bucket by the dynamic type so lookups by concrete type always hit */
+    size_t typeId = componentTypeId(std::type_index(typeid(*ptr)));
+    if (componentIndices.size() <= typeId) {
+      componentIndices.resize(typeId + 1);
+    }
+    componentIndices[typeId].push_back(components.size());
+    componentTypes.push_back(typeId);
+    componentMask.set(typeId);
+
     component->onAttach(this);
     components.push_back(std::move(component));
     return ptr;
   }
 
+  /* Components whose concrete type is exactly T */
   template <typename T>
-  std::vector<T*> getComponents() {
-    std::vector<T*> comps;
-    for (std::unique_ptr<Component>& component : components) {
-      if (T* casted = dynamic_cast<T*>(component.get())) {
-        comps.push_back(casted);
-      }
+  ComponentView<T> getComponents() const {
+    size_t typeId = componentTypeId<T>();
+    if (!componentMask.test(typeId)) {
+      return ComponentView<T>(&components, {});
     }
-    return comps;
+    return ComponentView<T>(&components, componentIndices[typeId]);
   }
 
   template <typename T>
-  void removeComponent() {
-    throw NotImplementedException("");
+  T* getComponent() const {
+    ComponentView<T> view = getComponents<T>();
+    return view.empty() ? nullptr : view[0];
+  }
+
+  /* Detaches one component of type T and hands it back. Does not keep the
+     relative order of the remaining components. */
+  template <typename T>
+  std::unique_ptr<T> removeComponent() {
+    size_t typeId = componentTypeId<T>();
+    if (!componentMask.test(typeId)) {
+      return nullptr;
+    }
+    std::vector<size_t>& bucket = componentIndices[typeId];
+    size_t idx = bucket.back();
+    bucket.pop_back();
+    if (bucket.empty()) {
+      componentMask.reset(typeId);
+    }
+
+    std::unique_ptr<T> removed(static_cast<T*>(components[idx].release()));
+    size_t last = components.size() - 1;
+    if (idx != last) {
+      components[idx] = std::move(components[last]);
+      componentTypes[idx] = componentTypes[last];
+      for (size_t& i : componentIndices[componentTypes[idx]]) {
+        if (i == last) {
+          i = idx;
+          break;
+        }
+      }
+    }
+    components.pop_back();
+    componentTypes.pop_back();
+
+    removed->onDetach();
+    return removed;
   }
 
   template <typename T>
-  T* hasComponent() {
-    throw NotImplementedException("");
+  bool hasComponent() const {
+    return componentMask.test(componentTypeId<T>());
   }
 
   virtual void update(float deltaTime);
@@ -117,14 +248,36 @@ class GameObject {
   const glm::quat& getRotation() const { return rotation; }
   const glm::vec3& getScale() const { return scale; }
   const glm::mat4& getModelMatrix() const;
+  uint64_t getTransformVersion() const { return transformVersion; }
+
+  bool getCastShadows() const { return castShadows; }
+  void setCastShadows(bool cast) { castShadows = cast; }
+  size_t getLodLevel() const { return lodLevel; }
+  void setLodLevel(size_t lod) { lodLevel = lod; }
   const std::shared_ptr<Material> getMaterial() const { return material; }
 
+  /* Overrides for this object only; the material stays shared */
+  const MaterialPropertyBlock& getPropertyBlock() const { return properties; }
+  void setPropertyBlock(const MaterialPropertyBlock& block) {
+    properties = block;
+  }
+  void setColor(const glm::vec3& color) { properties.color = color; }
+  void setTint(const glm::vec4& tint) { properties.tint = tint; }
+  void setUvOffset(const glm::vec2& offset) { properties.uvOffset = offset; }
+  const std::shared_ptr<Mesh> getMesh() const { return mesh; }
+
+  /* Mesh bounds in world space, radius 0 if there is no mesh */
+  void getWorldBoundingSphere(glm::vec3& center, float& radius) const;
+
   void faceDirection(const glm::vec3& targetDir);
 
   void setParent(GameObject* newParent);
   GameObject* addChild(std::unique_ptr<GameObject> child);
   std::unique_ptr<GameObject> removeChild(GameObject* child);
   GameObject* getParent() const { return parent; }
+  Scene* getScene() const { return scene; }
+  /* Propagates to children and notifies components. Called by Scene. */
+  void setScene(Scene* newScene);
   const std::vector<std::unique_ptr<GameObject>>& getChildren() const {
     return children;
   }
@@ -144,6 +297,12 @@ class GameObject {
 
   /* Assumes material is already bound */
   virtual void drawGeometry();
+
+  /* Depth-only draw with an already bound shader, used by shadow passes */
+  void drawDepth(Shader* shader);
+
+  /* Draws the mesh at the current LOD, no uniforms are touched */
+  void drawMesh();
 };
 
 #endif /* GAME_OBJECT_H */
@@ -0,0 +1,299 @@
+#include "src/indirect_renderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+
+#include "src/game_object.h"
+#include "src/logger.h"
+#include "src/material.h"
+#include "src/mesh.h"
+#include "src/utils.h"
+
+/* How long beginFrame waits for the GPU to release a ring region */
+static constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+static const glm::vec4 FULL_RECT(0.0F, 0.0F, 1.0F, 1.0F);
+
+IndirectRenderer::IndirectRenderer()
+    : initialized(false),
+      indirectSupported(false),
+      persistent(false),
+      commandBuffer(0),
+      drawDataBuffer(0),
+      drawDataTexture(0),
+      drawIdBuffer(0),
+      mappedCommands(nullptr),
+      mappedDrawData(nullptr),
+      fences{},
+      region(0),
+      used(0) {}
+
+IndirectRenderer::~IndirectRenderer() {
+  if (!initialized) {
+    return;
+  }
+  for (GLsync fence : fences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  /* Deleting a buffer also unmaps it */
+  glDeleteTextures(1, &drawDataTexture);
+  GLuint buffers[3] = {commandBuffer, drawDataBuffer, drawIdBuffer};
+  glDeleteBuffers(3, buffers);
+}
+
+void IndirectRenderer::initGL() {
+  indirectSupported = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+  persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+  LOG_INFO("Indirect renderer: multi-draw indirect ",
+           indirectSupported ? "on" : "off", ", persistent mapping ",
+           persistent ? "on" : "off");
+
+  const size_t slots = MAX_DRAWS * REGION_COUNT;
+  const size_t commandBytes = slots * sizeof(DrawElementsIndirectCommand);
+  const size_t drawDataBytes = slots * sizeof(DrawData);
+  const GLbitfield mapFlags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  glGenBuffers(1, &commandBuffer);
+  glGenBuffers(1, &drawDataBuffer);
+  glGenBuffers(1, &drawIdBuffer);
+
+  if (persistent) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, commandBytes, nullptr, mapFlags);
+    mappedCommands = static_cast<DrawElementsIndirectCommand*>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, commandBytes, mapFlags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, drawDataBuffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, drawDataBytes, nullptr, mapFlags);
+    mappedDrawData = static_cast<DrawData*>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, drawDataBytes, mapFlags));
+  } else {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, commandBytes, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, drawDataBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, drawDataBytes, nullptr,
+                 GL_STREAM_DRAW);
+    commands.resize(MAX_DRAWS);
+    drawData.resize(MAX_DRAWS);
+  }
+
+  std::vector<GLuint> drawIds(slots);
+  std::iota(drawIds.begin(), drawIds.end(), 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, drawIdBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, slots * sizeof(GLuint), drawIds.data(),
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glGenTextures(1, &drawDataTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, drawDataTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, drawDataBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+  /* Draws without the per-instance attribute read the current value */
+  glVertexAttribI1ui(DRAW_ID_LOCATION, 0);
+
+  checkGLError("after creating indirect renderer buffers");
+  initialized = true;
+}
+
+void IndirectRenderer::advanceRegion() {
+  if (persistent && used > 0) {
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  region = (region + 1) % REGION_COUNT;
+  used = 0;
+
+  /* The GPU may still read the region written REGION_COUNT frames ago */
+  if (fences[region]) {
+    GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     FENCE_TIMEOUT_NS);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+      LOG_WARNING("Timed out waiting for indirect draw region ", region);
+    }
+    glDeleteSync(fences[region]);
+    fences[region] = nullptr;
+  }
+}
+
+void IndirectRenderer::beginFrame() {
+  if (!initialized) {
+    initGL();
+  }
+  advanceRegion();
+}
+
+void IndirectRenderer::prepareVertexArray(GLuint vao) {
+  if (std::find(preparedVertexArrays.begin(), preparedVertexArrays.end(),
+                vao) != preparedVertexArrays.end()) {
+    return;
+  }
+  /* The pool VAO is bound; the draw id is one uint per instance */
+  glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+  glEnableVertexAttribArray(DRAW_ID_LOCATION);
+  glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, nullptr);
+  glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+  preparedVertexArrays.push_back(vao);
+}
+
+void IndirectRenderer::draw(Shader* shader,
+                            const std::vector<GameObject*>& objects,
+                            float materialIndex) {
+  if (!initialized) {
+    initGL();
+  }
+
+  glActiveTexture(GL_TEXTURE0 + DRAW_DATA_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, drawDataTexture);
+  glActiveTexture(GL_TEXTURE0);
+  shader->setUniform("drawData", static_cast<int>(DRAW_DATA_UNIT));
+
+  /* Pooled meshes first, runs of the same VAO and index type together */
+  sorted.clear();
+  for (GameObject* obj : objects) {
+    if (obj->getMesh()) {
+      sorted.push_back(obj);
+    }
+  }
+  auto batchKey = [](GameObject* obj) {
+    const Mesh* mesh = obj->getMesh().get();
+    return std::make_tuple(!mesh->isPooled(), mesh->getPool(),
+                           mesh->getVertexFormat(), mesh->getIndexType());
+  };
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [&batchKey](GameObject* a, GameObject* b) {
+                     return batchKey(a) < batchKey(b);
+                   });
+
+  for (size_t start = 0; start < sorted.size(); start += MAX_DRAWS) {
+    size_t count = std::min(MAX_DRAWS, sorted.size() - start);
+    if (used + count > MAX_DRAWS) {
+      advanceRegion();
+    }
+    drawChunk(shader, sorted.data() + start, count, materialIndex);
+  }
+}
+
+void IndirectRenderer::drawChunk(Shader* shader, GameObject* const* objects,
+                                 size_t count, float materialIndex) {
+  const size_t regionBase = region * MAX_DRAWS;
+  const size_t first = used;
+
+  DrawElementsIndirectCommand* commandOut =
+      persistent ? mappedCommands + regionBase : commands.data();
+  DrawData* drawDataOut =
+      persistent ? mappedDrawData + regionBase : drawData.data();
+
+  for (size_t i = 0; i < count; i++) {
+    const Mesh* mesh = objects[i]->getMesh().get();
+    size_t slot = first + i;
+
+    /* Objects of a layered group may use different materials. Only fully
+       packed ones read the arrays; the rest, even with some of their
+       textures packed, keep sampling their own sampler2D. */
+    const Material* material = objects[i]->getMaterial().get();
+    const TextureSlot* diffuse = nullptr;
+    const TextureSlot* specular = nullptr;
+    if (material->isLayered()) {
+      diffuse = material->getTexture()->getSlot();
+      if (material->getSpecular()) {
+        specular = material->getSpecular()->getSlot();
+      }
+    }
+
+    DrawData data;
+    data.model = objects[i]->getModelMatrix();
+    data.params = glm::vec4(
+        materialIndex, material->getShininess(),
+        diffuse ? static_cast<float>(diffuse->layer) : -1.0F,
+        specular ? static_cast<float>(specular->layer) : -1.0F);
+    data.diffuseRect = diffuse ? diffuse->rect : FULL_RECT;
+    data.specularRect = specular ? specular->rect : FULL_RECT;
+    const MaterialPropertyBlock& properties = objects[i]->getPropertyBlock();
+    /* Lit textured shaders don't use the material's base color */
+    data.color = properties.resolveColor(glm::vec3(1.0F));
+    data.uvOffset =
+        glm::vec4(properties.uvOffset.x, properties.uvOffset.y, 0.0F, 0.0F);
+    drawDataOut[persistent ? slot : i] = data;
+
+    DrawElementsIndirectCommand command = {};
+    if (mesh->isPooled()) {
+      const MeshPoolAllocation& allocation = mesh->getPoolAllocation();
+      const MeshLod& lod = mesh->getLod(objects[i]->getLodLevel());
+      command.count = static_cast<GLuint>(lod.indicesCount);
+      command.instanceCount = 1;
+      command.firstIndex =
+          allocation.firstIndex() + static_cast<GLuint>(lod.firstIndex);
+      command.baseVertex = allocation.baseVertex;
+      command.baseInstance = static_cast<GLuint>(regionBase + slot);
+    }
+    commandOut[persistent ? slot : i] = command;
+  }
+  used += count;
+
+  if (!persistent) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, drawDataBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    (regionBase + first) * sizeof(DrawData),
+                    count * sizeof(DrawData), drawData.data());
+    if (indirectSupported) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+      glBufferSubData(GL_COPY_WRITE_BUFFER,
+                      (regionBase + first) *
+                          sizeof(DrawElementsIndirectCommand),
+                      count * sizeof(DrawElementsIndirectCommand),
+                      commands.data());
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  size_t i = 0;
+  while (i < count) {
+    const Mesh* mesh = objects[i]->getMesh().get();
+    GLuint slot = static_cast<GLuint>(regionBase + first + i);
+
+    if (!mesh->isPooled()) {
+      shader->setUniform("drawIdOffset", static_cast<int>(slot));
+      objects[i]->drawMesh();
+      i++;
+      continue;
+    }
+
+    MeshPool* pool = mesh->getPool();
+    VertexFormat format = mesh->getVertexFormat();
+    GLenum indexType = mesh->getIndexType();
+    size_t runEnd = i + 1;
+    while (runEnd < count) {
+      const Mesh* next = objects[runEnd]->getMesh().get();
+      if (next->getPool() != pool || next->getVertexFormat() != format ||
+          next->getIndexType() != indexType) {
+        break;
+      }
+      runEnd++;
+    }
+
+    pool->bind(format);
+    if (indirectSupported) {
+      prepareVertexArray(pool->getVertexArray(format));
+      shader->setUniform("drawIdOffset", 0);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+      glMultiDrawElementsIndirect(
+          GL_TRIANGLES, indexType,
+          (void*)(slot * sizeof(DrawElementsIndirectCommand)),
+          static_cast<GLsizei>(runEnd - i), 0);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else {
+      /* No base instance on GL 3.3, so the slot has to come from a uniform
+         and the draws can't be merged into one call */
+      for (size_t j = i; j < runEnd; j++) {
+        shader->setUniform("drawIdOffset",
+                           static_cast<int>(regionBase + first + j));
+        objects[j]->drawMesh();
+      }
+    }
+    i = runEnd;
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "src/shader.h"
+
+class GameObject;
+
+/* Layout fixed by glMultiDrawElementsIndirect */
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+/* Per-draw data, read by shaders/draw_data_incl.vert */
+struct DrawData {
+  glm::mat4 model;
+  /* x: index of the material within the frame, y: shininess,
+     z/w: diffuse/specular layer, -1 when not packed into an array */
+  glm::vec4 params;
+  /* TextureSlot::rect of the diffuse and specular textures */
+  glm::vec4 diffuseRect;
+  glm::vec4 specularRect;
+  /* MaterialPropertyBlock of the object, color resolved against white;
+     uvOffset in xy */
+  glm::vec4 color;
+  glm::vec4 uvOffset;
+};
+
+/* Draws a render queue group with as few GL calls as possible. Commands and
+   per-draw data go into ring buffers (persistently mapped when
+   GL_ARB_buffer_storage is there); shaders find their DrawData through a
+   per-instance draw id, which baseInstance points at the right slot.
+   Meshes in a MeshPool are submitted with one glMultiDrawElementsIndirect
+   per (format, index type) run. Without GL_ARB_multi_draw_indirect, or for
+   unpooled meshes, each draw selects its slot through drawIdOffset. */
+class IndirectRenderer {
+ public:
+  /* Draw slots per ring region; a frame that needs more moves on to the
+     next region */
+  static constexpr size_t MAX_DRAWS = 4096;
+  static constexpr size_t REGION_COUNT = 3;
+  static constexpr size_t TEXELS_PER_DRAW = sizeof(DrawData) / 16;
+
+  /* Texture unit above the ones used by ShadowRenderer */
+  static constexpr GLuint DRAW_DATA_UNIT = 8;
+  /* Keep in sync with shaders/draw_data_incl.vert */
+  static constexpr GLuint DRAW_ID_LOCATION = 3;
+
+ private:
+  bool initialized;
+  bool indirectSupported;
+  bool persistent;
+
+  GLuint commandBuffer;
+  GLuint drawDataBuffer;
+  GLuint drawDataTexture;
+  /* 0, 1, 2, ... sourced per instance, offset by baseInstance */
+  GLuint drawIdBuffer;
+
+  DrawElementsIndirectCommand* mappedCommands;
+  DrawData* mappedDrawData;
+  /* Staging for glBufferSubData when buffers can't stay mapped */
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<DrawData> drawData;
+
+  GLsync fences[REGION_COUNT];
+  size_t region;
+  size_t used;
+
+  std::vector<GLuint> preparedVertexArrays;
+  std::vector<GameObject*> sorted;
+
+  void initGL();
+  void advanceRegion();
+  void prepareVertexArray(GLuint vao);
+  void drawChunk(Shader* shader, GameObject* const* objects, size_t count,
+                 float materialIndex);
+
+ public:
+  IndirectRenderer();
+  ~IndirectRenderer();
+
+  IndirectRenderer(const IndirectRenderer&) = delete;
+  IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+  /* Shaders opt in by including draw_data_incl.vert */
+  static bool isBatchable(Shader* shader) {
+    return shader->hasUniform("drawData");
+  }
+
+  void beginFrame();
+
+  /* Draws objects with an already bound, batchable shader */
+  void draw(Shader* shader, const std::vector<GameObject*>& objects,
+            float materialIndex);
+
+  bool isIndirect() const { return indirectSupported; }
+};
+
+#endif /* INDIRECT_RENDERER_H */
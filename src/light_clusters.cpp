@@ -0,0 +1,334 @@
+#include "src/light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "src/logger.h"
+#include "src/point_light_component.h"
+#include "src/spotlight_component.h"
+#include "src/thread_pool.h"
+#include "src/utils.h"
+
+/* Below this many lights binning is cheaper than waking up the workers */
+static constexpr size_t PARALLEL_LIGHT_THRESHOLD = 64;
+
+/* Point lights are stored as spotlights whose cone covers every direction:
+   cos(theta) >= -1 always passes an outer cutoff of -3 */
+static constexpr float POINT_LIGHT_CUTOFF = -2.0F;
+static constexpr float POINT_LIGHT_OUTER_CUTOFF = -3.0F;
+
+LightClusters::LightClusters()
+    : minX(CLUSTER_COUNT),
+      minY(CLUSTER_COUNT),
+      minZ(CLUSTER_COUNT),
+      maxX(CLUSTER_COUNT),
+      maxY(CLUSTER_COUNT),
+      maxZ(CLUSTER_COUNT),
+      boundsFov(0.0F),
+      boundsAspect(0.0F),
+      boundsNear(0.0F),
+      boundsFar(0.0F),
+      tanHalfFovY(0.0F),
+      depthScale(0.0F),
+      slices(GRID_Z),
+      grid(CLUSTER_COUNT * 2),
+      initialized(false),
+      buffers{0, 0, 0},
+      textures{0, 0, 0} {}
+
+LightClusters::~LightClusters() {
+  if (initialized) {
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+  }
+}
+
+void LightClusters::initGL() {
+  glGenBuffers(3, buffers);
+  glGenTextures(3, textures);
+
+  const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+  for (int i = 0; i < 3; i++) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+  }
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  checkGLError("after creating light cluster buffers");
+  initialized = true;
+}
+
+float LightClusters::sliceDepth(int slice) const {
+  return boundsNear *
+         std::pow(boundsFar / boundsNear, static_cast<float>(slice) / GRID_Z);
+}
+
+int LightClusters::depthToSlice(float depth) const {
+  int slice = static_cast<int>(std::floor(std::log(depth / boundsNear) *
+                                          depthScale));
+  return std::clamp(slice, 0, GRID_Z - 1);
+}
+
+void LightClusters::rebuildClusterBounds(const Camera& camera) {
+  boundsFov = camera.getFov();
+  boundsAspect = camera.getAspectRatio();
+  boundsNear = camera.getNearPlane();
+  boundsFar = camera.getFarPlane();
+  tanHalfFovY = std::tan(glm::radians(boundsFov) * 0.5F);
+  depthScale = GRID_Z / std::log(boundsFar / boundsNear);
+
+  LOG_DEBUG("Rebuilding light cluster bounds");
+
+  float tanHalfFovX = tanHalfFovY * boundsAspect;
+  for (int z = 0; z < GRID_Z; z++) {
+    float nearDepth = sliceDepth(z);
+    float farDepth = sliceDepth(z + 1);
+    for (int y = 0; y < GRID_Y; y++) {
+      float ndcY0 = -1.0F + 2.0F * y / GRID_Y;
+      float ndcY1 = -1.0F + 2.0F * (y + 1) / GRID_Y;
+      for (int x = 0; x < GRID_X; x++) {
+        float ndcX0 = -1.0F + 2.0F * x / GRID_X;
+        float ndcX1 = -1.0F + 2.0F * (x + 1) / GRID_X;
+
+        /* The tile's side planes pass through the eye, so its extent at the
+           near and far depth of the slice bound the cluster */
+        float xs[4] = {ndcX0 * tanHalfFovX * nearDepth,
+                       ndcX0 * tanHalfFovX * farDepth,
+                       ndcX1 * tanHalfFovX * nearDepth,
+                       ndcX1 * tanHalfFovX * farDepth};
+        float ys[4] = {ndcY0 * tanHalfFovY * nearDepth,
+                       ndcY0 * tanHalfFovY * farDepth,
+                       ndcY1 * tanHalfFovY * nearDepth,
+                       ndcY1 * tanHalfFovY * farDepth};
+
+        size_t c = (z * GRID_Y + y) * GRID_X + x;
+        minX[c] = *std::min_element(xs, xs + 4);
+        maxX[c] = *std::max_element(xs, xs + 4);
+        minY[c] = *std::min_element(ys, ys + 4);
+        maxY[c] = *std::max_element(ys, ys + 4);
+        minZ[c] = nearDepth;
+        maxZ[c] = farDepth;
+      }
+    }
+  }
+}
+
+void LightClusters::addBounds(const glm::mat4& view, const glm::vec3& position,
+                              float range) {
+  glm::vec3 viewPos = glm::vec3(view * glm::vec4(position, 1.0F));
+  LightBounds bounds;
+  bounds.x = viewPos.x;
+  bounds.y = viewPos.y;
+  bounds.depth = -viewPos.z;
+  bounds.radius = std::min(range, boundsFar);
+
+  if (bounds.depth + bounds.radius < boundsNear ||
+      bounds.depth - bounds.radius > boundsFar) {
+    /* Outside the depth range, keep the light data but never bin it */
+    bounds.firstSlice = GRID_Z;
+    bounds.lastSlice = -1;
+  } else {
+    bounds.firstSlice =
+        depthToSlice(std::max(bounds.depth - bounds.radius, boundsNear));
+    bounds.lastSlice =
+        depthToSlice(std::min(bounds.depth + bounds.radius, boundsFar));
+  }
+  lightBounds.push_back(bounds);
+}
+
+void LightClusters::binSlice(int z) {
+  SliceBins& bins = slices[z];
+  bins.clusters.clear();
+  bins.lights.clear();
+
+  float sliceNear = sliceDepth(z);
+  float sliceFar = sliceDepth(z + 1);
+  float tanHalfFovX = tanHalfFovY * boundsAspect;
+
+  bool hits[GRID_X];
+
+  for (uint32_t l = 0; l < lightBounds.size(); l++) {
+    const LightBounds& light = lightBounds[l];
+    if (z < light.firstSlice || z > light.lastSlice) {
+      continue;
+    }
+
+    /* Conservative tile range: project the sphere's AABB clipped to the
+       slice. x / depth is monotonic in both, so corners give the extremes */
+    float d0 = std::max(sliceNear, light.depth - light.radius);
+    float d1 = std::min(sliceFar, light.depth + light.radius);
+    float x0 = light.x - light.radius;
+    float x1 = light.x + light.radius;
+    float y0 = light.y - light.radius;
+    float y1 = light.y + light.radius;
+
+    float ndcMinX = std::min(x0 / d0, x0 / d1) / tanHalfFovX;
+    float ndcMaxX = std::max(x1 / d0, x1 / d1) / tanHalfFovX;
+    float ndcMinY = std::min(y0 / d0, y0 / d1) / tanHalfFovY;
+    float ndcMaxY = std::max(y1 / d0, y1 / d1) / tanHalfFovY;
+
+    if (ndcMaxX < -1.0F || ndcMinX > 1.0F || ndcMaxY < -1.0F ||
+        ndcMinY > 1.0F) {
+      continue;
+    }
+
+    int tileX0 = std::clamp(
+        static_cast<int>((ndcMinX * 0.5F + 0.5F) * GRID_X), 0, GRID_X - 1);
+    int tileX1 = std::clamp(
+        static_cast<int>((ndcMaxX * 0.5F + 0.5F) * GRID_X), 0, GRID_X - 1);
+    int tileY0 = std::clamp(
+        static_cast<int>((ndcMinY * 0.5F + 0.5F) * GRID_Y), 0, GRID_Y - 1);
+    int tileY1 = std::clamp(
+        static_cast<int>((ndcMaxY * 0.5F + 0.5F) * GRID_Y), 0, GRID_Y - 1);
+
+    float radius2 = light.radius * light.radius;
+    for (int y = tileY0; y <= tileY1; y++) {
+      size_t row = (z * GRID_Y + y) * GRID_X;
+
+      /* Branchless sphere vs AABB over the row, vectorized by the compiler */
+      for (int x = tileX0; x <= tileX1; x++) {
+        size_t c = row + x;
+        float dx = std::max(std::max(minX[c] - light.x, 0.0F),
+                            light.x - maxX[c]);
+        float dy = std::max(std::max(minY[c] - light.y, 0.0F),
+                            light.y - maxY[c]);
+        float dz = std::max(std::max(minZ[c] - light.depth, 0.0F),
+                            light.depth - maxZ[c]);
+        hits[x] = dx * dx + dy * dy + dz * dz <= radius2;
+      }
+
+      for (int x = tileX0; x <= tileX1; x++) {
+        if (hits[x]) {
+          bins.clusters.push_back(y * GRID_X + x);
+          bins.lights.push_back(l);
+        }
+      }
+    }
+  }
+
+  /* Counting sort of (cluster, light) pairs into per-cluster lists */
+  bins.offsets.assign(SLICE_SIZE + 1, 0);
+  for (uint32_t cluster : bins.clusters) {
+    bins.offsets[cluster + 1]++;
+  }
+  for (int c = 0; c < SLICE_SIZE; c++) {
+    bins.offsets[c + 1] += bins.offsets[c];
+  }
+
+  bins.indices.resize(bins.lights.size());
+  bins.cursor.assign(bins.offsets.begin(), bins.offsets.end() - 1);
+  for (size_t i = 0; i < bins.clusters.size(); i++) {
+    bins.indices[bins.cursor[bins.clusters[i]]++] = bins.lights[i];
+  }
+}
+
+void LightClusters::update(
+    const Camera& camera, const std::vector<PointLightComponent*>& pointLights,
+    const std::vector<SpotlightComponent*>& spotLights) {
+  if (!initialized) {
+    initGL();
+  }
+
+  if (camera.getFov() != boundsFov ||
+      camera.getAspectRatio() != boundsAspect ||
+      camera.getNearPlane() != boundsNear ||
+      camera.getFarPlane() != boundsFar) {
+    rebuildClusterBounds(camera);
+  }
+
+  const glm::mat4& view = camera.getViewMatrix();
+  lightBounds.clear();
+  lightData.clear();
+
+  for (PointLightComponent* light : pointLights) {
+    glm::vec3 position = light->getGameObject()->getWorldPosition();
+    addBounds(view, position, light->getRange());
+
+    lightData.push_back(glm::vec4(position, POINT_LIGHT_CUTOFF));
+    lightData.push_back(
+        glm::vec4(glm::vec3(0.0F, 0.0F, -1.0F), POINT_LIGHT_OUTER_CUTOFF));
+    lightData.push_back(glm::vec4(light->getAmbient(), light->getConstant()));
+    lightData.push_back(glm::vec4(light->getDiffuse(), light->getLinear()));
+    lightData.push_back(glm::vec4(light->getSpecular(), light->getQuadratic()));
+    lightData.push_back(glm::vec4(-1.0F, 0.0F, 0.0F, 0.0F));
+  }
+
+  for (SpotlightComponent* light : spotLights) {
+    glm::vec3 position = light->getGameObject()->getWorldPosition();
+    addBounds(view, position, light->getRange());
+
+    lightData.push_back(glm::vec4(position, light->getCutOff()));
+    lightData.push_back(
+        glm::vec4(light->getDirection(), light->getOuterCutOff()));
+    lightData.push_back(glm::vec4(light->getAmbient(), light->getConstant()));
+    lightData.push_back(glm::vec4(light->getDiffuse(), light->getLinear()));
+    lightData.push_back(glm::vec4(light->getSpecular(), light->getQuadratic()));
+    lightData.push_back(
+        glm::vec4(static_cast<float>(light->getShadowIndex()), 0.0F, 0.0F,
+                  0.0F));
+  }
+
+  if (lightBounds.size() >= PARALLEL_LIGHT_THRESHOLD) {
+    ThreadPool::global().parallelFor(GRID_Z,
+                                     [this](size_t z) { binSlice(z); });
+  } else {
+    for (int z = 0; z < GRID_Z; z++) {
+      binSlice(z);
+    }
+  }
+
+  indices.clear();
+  for (int z = 0; z < GRID_Z; z++) {
+    const SliceBins& bins = slices[z];
+    uint32_t base = indices.size();
+    for (int c = 0; c < SLICE_SIZE; c++) {
+      size_t cluster = z * SLICE_SIZE + c;
+      grid[cluster * 2] = base + bins.offsets[c];
+      grid[cluster * 2 + 1] = bins.offsets[c + 1] - bins.offsets[c];
+    }
+    indices.insert(indices.end(), bins.indices.begin(), bins.indices.end());
+  }
+
+  LOG_DEBUG("Binned ", lightBounds.size(), " lights into ", indices.size(),
+            " cluster entries");
+  upload();
+}
+
+void LightClusters::upload() {
+  /* Re-specifying the whole store each frame lets the driver orphan it */
+  auto uploadBuffer = [](GLuint buffer, size_t size, const void* data) {
+    static const uint32_t zero[4] = {0, 0, 0, 0};
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    if (size == 0) {
+      glBufferData(GL_TEXTURE_BUFFER, sizeof(zero), zero, GL_STREAM_DRAW);
+    } else {
+      glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+    }
+  };
+
+  uploadBuffer(buffers[0], lightData.size() * sizeof(glm::vec4),
+               lightData.data());
+  uploadBuffer(buffers[1], grid.size() * sizeof(uint32_t), grid.data());
+  uploadBuffer(buffers[2], indices.size() * sizeof(uint32_t), indices.data());
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  checkGLError("after uploading light clusters");
+}
+
+void LightClusters::bind(Shader* shader) const {
+  const GLuint units[3] = {LIGHT_DATA_UNIT, GRID_UNIT, INDEX_UNIT};
+  for (int i = 0; i < 3; i++) {
+    glActiveTexture(GL_TEXTURE0 + units[i]);
+    glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  shader->setUniform("clusterLightData", static_cast<int>(LIGHT_DATA_UNIT));
+  shader->setUniform("clusterGrid", static_cast<int>(GRID_UNIT));
+  shader->setUniform("clusterLightIndices", static_cast<int>(INDEX_UNIT));
+  shader->setUniform("clusterNear", boundsNear);
+  shader->setUniform("clusterFar", boundsFar);
+}
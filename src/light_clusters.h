@@ -0,0 +1,101 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "src/camera.h"
+#include "src/shader.h"
+
+class PointLightComponent;
+class SpotlightComponent;
+
+/* Clustered forward lighting: bins point and spot lights into a view-space
+   froxel grid on the CPU and exposes the per-cluster light lists to shaders
+   through buffer textures (see shaders/light_clustered_incl.frag). */
+class LightClusters {
+ public:
+  /* Keep in sync with shaders/light_clustered_incl.frag */
+  static constexpr int GRID_X = 16;
+  static constexpr int GRID_Y = 9;
+  static constexpr int GRID_Z = 24;
+  static constexpr int SLICE_SIZE = GRID_X * GRID_Y;
+  static constexpr int CLUSTER_COUNT = SLICE_SIZE * GRID_Z;
+  static constexpr int TEXELS_PER_LIGHT = 6;
+
+  /* Texture units, chosen above the ones used by Material */
+  static constexpr GLuint LIGHT_DATA_UNIT = 4;
+  static constexpr GLuint GRID_UNIT = 5;
+  static constexpr GLuint INDEX_UNIT = 6;
+
+ private:
+  /* View-space light sphere, depth is positive in front of the camera */
+  struct LightBounds {
+    float x, y, depth;
+    float radius;
+    int firstSlice, lastSlice;
+  };
+
+  /* Per depth-slice binning output, each slice is binned independently */
+  struct SliceBins {
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> lights;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> cursor;
+    std::vector<uint32_t> indices;
+  };
+
+  /* Cluster AABBs in view space (depth positive) as structure of arrays, so
+     the sphere overlap test over a row of clusters auto-vectorizes */
+  std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+  float boundsFov;
+  float boundsAspect;
+  float boundsNear;
+  float boundsFar;
+  float tanHalfFovY;
+  float depthScale;
+
+  std::vector<LightBounds> lightBounds;
+  std::vector<glm::vec4> lightData;
+  std::vector<SliceBins> slices;
+
+  /* Cluster index -> (offset, count) into indices */
+  std::vector<uint32_t> grid;
+  std::vector<uint32_t> indices;
+
+  bool initialized;
+  GLuint buffers[3];
+  GLuint textures[3];
+
+  void initGL();
+  void rebuildClusterBounds(const Camera& camera);
+  float sliceDepth(int slice) const;
+  int depthToSlice(float depth) const;
+  void addBounds(const glm::mat4& view, const glm::vec3& position,
+                 float range);
+  void binSlice(int slice);
+  void upload();
+
+ public:
+  LightClusters();
+  ~LightClusters();
+
+  LightClusters(const LightClusters&) = delete;
+  LightClusters& operator=(const LightClusters&) = delete;
+
+  void update(const Camera& camera,
+              const std::vector<PointLightComponent*>& pointLights,
+              const std::vector<SpotlightComponent*>& spotLights);
+
+  /* Binds the cluster buffers and sets the sampler uniforms */
+  void bind(Shader* shader) const;
+
+  size_t getLightCount() const { return lightBounds.size(); }
+  size_t getIndexCount() const { return indices.size(); }
+};
+
+#endif /* LIGHT_CLUSTERS_H */
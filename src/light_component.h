@@ -1,15 +1,44 @@
 #ifndef LIGHT_COMPONENT_H
 #define LIGHT_COMPONENT_H
 
+#include <limits>
 #include <memory>
 
 #include <glm/glm.hpp>
 
 #include "src/component.h"
 #include "src/game_object.h"
+#include "src/scene.h"
 #include "src/shader.h"
 
+enum class LightType {
+  DIRECTIONAL,
+  POINT,
+  SPOT,
+};
+
 class LightComponent : public Component {
+ private:
+  LightType type;
+  /* Scene whose light lists currently contain this light */
+  Scene* registeredScene;
+
+  /* Keeps the scene's typed light lists in sync: a light is registered iff
+     it is enabled and its GameObject is part of a scene. */
+  void syncRegistration() {
+    Scene* target = (enabled && gameObject) ? gameObject->getScene() : nullptr;
+    if (target == registeredScene) {
+      return;
+    }
+    if (registeredScene) {
+      registeredScene->unregisterLight(this);
+    }
+    if (target) {
+      target->registerLight(this);
+    }
+    registeredScene = target;
+  }
+
  protected:
   glm::vec3 ambient;
   glm::vec3 diffuse;
@@ -17,22 +46,72 @@ class LightComponent : public Component {
 
   virtual std::string getUniformArrayName() const = 0;
 
+  /* Distance at which 1 / (c + l * d + q * d^2) scaled by the brightest
+     channel of the light drops below 1/256 */
+  float attenuationRange(float constant, float linear, float quadratic) const {
+    auto maxChannel = [](const glm::vec3& c) {
+      return glm::max(c.x, glm::max(c.y, c.z));
+    };
+    float intensity = glm::max(maxChannel(ambient),
+                               glm::max(maxChannel(diffuse),
+                                        maxChannel(specular)));
+    float target = 256.0F * intensity - constant;
+    if (target <= 0.0F) {
+      return 0.0F;
+    }
+    if (quadratic > 0.0F) {
+      float discriminant = linear * linear + 4.0F * quadratic * target;
+      return (-linear + glm::sqrt(discriminant)) / (2.0F * quadratic);
+    }
+    if (linear > 0.0F) {
+      return target / linear;
+    }
+    return std::numeric_limits<float>::infinity();
+  }
+
   std::string makeUniformName(int index, const std::string& property) const {
     return getUniformArrayName() + "[" + std::to_string(index) + "]." +
            property;
   }
 
  public:
-  LightComponent(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular)
-      : Component(), ambient(ambient), diffuse(diffuse), specular(specular) {}
+  LightComponent(LightType type, glm::vec3 ambient, glm::vec3 diffuse,
+                 glm::vec3 specular)
+      : Component(),
+        type(type),
+        registeredScene(nullptr),
+        ambient(ambient),
+        diffuse(diffuse),
+        specular(specular) {}
+
+  ~LightComponent() override {
+    if (registeredScene) {
+      registeredScene->unregisterLight(this);
+    }
+  }
 
   void onAttach(GameObject* obj) override {
     Component::onAttach(obj);
     if (gameObject && gameObject->getMaterial()) {
       gameObject->getMaterial()->setBaseColor(diffuse);
     }
+    syncRegistration();
   }
 
+  void onDetach() override {
+    Component::onDetach();
+    syncRegistration();
+  }
+
+  void onSceneChanged() override { syncRegistration(); }
+
+  void setEnabled(bool e) override {
+    Component::setEnabled(e);
+    syncRegistration();
+  }
+
+  LightType getLightType() const { return type; }
+
   void update(float deltaTime) override { (void)deltaTime; }
 
   std::string getTypeName() const override { return "LightComponent"; }
@@ -1,6 +1,7 @@
 #include "src/material.h"
 
 #include "src/logger.h"
+#include "src/texture_array.h"
 
 Material::Material(std::shared_ptr<Shader> shader,
                    std::shared_ptr<Texture> texture,
@@ -11,18 +12,37 @@ Material::Material(std::shared_ptr<Shader> shader,
       specular(std::move(specular)),
       shininess(shininess),
       baseColor(baseColor),
-      opaque(opaque) {}
+      opaque(opaque),
+      blockBuffer(MaterialBuffer::acquire()),
+      blockSlot(blockBuffer->allocate()),
+      blockDirty(true) {}
+
+Material::~Material() {
+  blockBuffer->release(blockSlot);
+}
 
 void Material::bind() const {
   if (shader) {
     shader->use();
 
-    if (shader->hasUniform("material.shininess")) {
-      shader->setUniform("material.shininess", shininess);
-    }
-
-    if (shader->hasUniform("baseColor")) {
-      shader->setUniform("baseColor", baseColor);
+    if (shader->bindUniformBlock(MaterialBuffer::BLOCK_NAME,
+                                 MaterialBuffer::BINDING)) {
+      if (blockDirty) {
+        MaterialBlock block = {};
+        block.baseColor = glm::vec4(baseColor, 1.0F);
+        block.shininess = shininess;
+        blockBuffer->write(blockSlot, block);
+        blockDirty = false;
+      }
+      blockBuffer->bind(blockSlot);
+    } else {
+      /* Shaders without MaterialBlock still get the plain uniforms */
+      if (shader->hasUniform("material.shininess")) {
+        shader->setUniform("material.shininess", shininess);
+      }
+      if (shader->hasUniform("baseColor")) {
+        shader->setUniform("baseColor", baseColor);
+      }
     }
     if (texture) {
       texture->bind(0);
@@ -32,5 +52,35 @@ void Material::bind() const {
       specular->bind(1);
       shader->setUniform("material.specular", 1);
     }
+
+    if (shader->hasUniform("layeredMaterial.diffuse")) {
+      /* Set even when unpacked, both samplers defaulting to unit 0 would
+         clash with material.diffuse */
+      shader->setUniform("layeredMaterial.diffuse",
+                         static_cast<int>(LAYERED_DIFFUSE_UNIT));
+      shader->setUniform("layeredMaterial.specular",
+                         static_cast<int>(LAYERED_SPECULAR_UNIT));
+      if (texture && texture->getSlot()) {
+        texture->getSlot()->array->bind(LAYERED_DIFFUSE_UNIT);
+      }
+      if (specular && specular->getSlot()) {
+        specular->getSlot()->array->bind(LAYERED_SPECULAR_UNIT);
+      }
+      glActiveTexture(GL_TEXTURE0);
+    }
   }
 }
+
+glm::vec4 MaterialPropertyBlock::colorOverride() const {
+  return color ? glm::vec4(*color, 1.0F) : glm::vec4(0.0F);
+}
+
+glm::vec4 MaterialPropertyBlock::resolveColor(
+    const glm::vec3& baseColor) const {
+  return glm::vec4(color.value_or(baseColor), 1.0F) * tint;
+}
+
+bool Material::isLayered() const {
+  return shader && shader->hasUniform("layeredMaterial.diffuse") && texture &&
+         texture->getSlot() && (!specular || specular->getSlot());
+}
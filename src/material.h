@@ -2,14 +2,40 @@
 #define MATERIAL_H
 
 #include <memory>
+#include <optional>
 
 #include <glm/glm.hpp>
 
 #include "src/logger.h"
+#include "src/material_buffer.h"
 #include "src/shader.h"
 #include "src/texture.h"
 
+/* Per-object values layered over a material, so objects can vary without
+   their own Material and keep sharing its batch. Shaders receive them as
+   the instanceColor / instanceTint / instanceUvOffset uniforms, or through
+   draw data when batched. */
+struct MaterialPropertyBlock {
+  /* Replaces the material's base color when set */
+  std::optional<glm::vec3> color;
+  /* Multiplies the resulting color */
+  glm::vec4 tint = glm::vec4(1.0F);
+  /* Added to texture coordinates */
+  glm::vec2 uvOffset = glm::vec2(0.0F);
+
+  /* color in rgb with a as its weight against the material's: 1 if set */
+  glm::vec4 colorOverride() const;
+  /* Final color for a material base color, alpha from the tint */
+  glm::vec4 resolveColor(const glm::vec3& baseColor) const;
+};
+
 class Material {
+ public:
+  /* Units for shaders declaring layeredMaterial, kept apart from the
+     sampler2D units since a unit can't serve two sampler types */
+  static constexpr GLuint LAYERED_DIFFUSE_UNIT = 2;
+  static constexpr GLuint LAYERED_SPECULAR_UNIT = 3;
+
  private:
   std::string name;
   /* TODO: in the future the material could store a list of pairs to know what uniforms to bind */
@@ -22,11 +48,22 @@ class Material {
   glm::vec3 baseColor;
   bool opaque;
 
+  /* Parameters live in this slot of the shared MaterialBuffer and are
+     re-uploaded only after a setter changed them */
+  std::shared_ptr<MaterialBuffer> blockBuffer;
+  size_t blockSlot;
+  mutable bool blockDirty;
+
  public:
   Material(std::shared_ptr<Shader> shader,
            std::shared_ptr<Texture> texture = nullptr,
            std::shared_ptr<Texture> specular = nullptr, float shininess = 32,
            glm::vec3 baseColor = glm::vec3(1.0F), bool isOpaque = true);
+  ~Material();
+
+  /* Each material owns a slot of the material buffer */
+  Material(const Material&) = delete;
+  Material& operator=(const Material&) = delete;
 
   void bind() const;
 
@@ -35,10 +72,26 @@ class Material {
 
   std::shared_ptr<Shader> getShader() const { return shader; }
   std::shared_ptr<Texture> getTexture() const { return texture; }
+  std::shared_ptr<Texture> getSpecular() const { return specular; }
+  float getShininess() const { return shininess; }
+
+  void setShininess(float newShininess) {
+    shininess = newShininess;
+    blockDirty = true;
+  }
+
+  /* Whether the shader samples texture arrays (layeredMaterial) and all
+     textures of this material have been packed into one. Such materials
+     take layers and shininess from per-draw data, so every one sharing the
+     shader and arrays can be drawn in the same batch. */
+  bool isLayered() const;
 
   void setShader(std::shared_ptr<Shader> s) { shader = std::move(s); }
   void setTexture(std::shared_ptr<Texture> tex) { texture = std::move(tex); }
-  void setBaseColor(const glm::vec3& color) { baseColor = color; }
+  void setBaseColor(const glm::vec3& color) {
+    baseColor = color;
+    blockDirty = true;
+  }
 
   bool isOpaque() const { return opaque; }
 
@@ -0,0 +1,93 @@
+#include "src/material_buffer.h"
+
+#include <algorithm>
+
+#include "src/logger.h"
+
+MaterialBuffer::MaterialBuffer()
+    : buffer(0),
+      stride(sizeof(MaterialBlock)),
+      capacity(0),
+      slotCount(0),
+      initialized(false) {}
+
+MaterialBuffer::~MaterialBuffer() {
+  if (initialized) {
+    glDeleteBuffers(1, &buffer);
+  }
+}
+
+std::shared_ptr<MaterialBuffer> MaterialBuffer::acquire() {
+  static std::weak_ptr<MaterialBuffer> shared;
+  std::shared_ptr<MaterialBuffer> materialBuffer = shared.lock();
+  if (!materialBuffer) {
+    materialBuffer = std::make_shared<MaterialBuffer>();
+    shared = materialBuffer;
+  }
+  return materialBuffer;
+}
+
+void MaterialBuffer::initGL() {
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  stride = (sizeof(MaterialBlock) + alignment - 1) / alignment * alignment;
+  initialized = true;
+  reserve(std::max(INITIAL_CAPACITY, slotCount));
+}
+
+void MaterialBuffer::reserve(size_t slots) {
+  if (slots <= capacity) {
+    return;
+  }
+  size_t newCapacity = std::max(capacity * 2, slots);
+
+  GLuint newBuffer;
+  glGenBuffers(1, &newBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * stride, nullptr,
+               GL_DYNAMIC_DRAW);
+  if (capacity > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        capacity * stride);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  LOG_DEBUG("Material buffer grown to ", newCapacity, " slots");
+  buffer = newBuffer;
+  capacity = newCapacity;
+}
+
+size_t MaterialBuffer::allocate() {
+  if (!freeSlots.empty()) {
+    size_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+  return slotCount++;
+}
+
+void MaterialBuffer::release(size_t slot) {
+  freeSlots.push_back(slot);
+}
+
+void MaterialBuffer::write(size_t slot, const MaterialBlock& block) {
+  if (!initialized) {
+    initGL();
+  }
+  reserve(slot + 1);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, slot * stride, sizeof(block), &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void MaterialBuffer::bind(size_t slot) {
+  if (!initialized) {
+    initGL();
+  }
+  reserve(slot + 1);
+  glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, buffer, slot * stride,
+                    sizeof(MaterialBlock));
+}
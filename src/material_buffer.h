@@ -0,0 +1,61 @@
+#ifndef MATERIAL_BUFFER_H
+#define MATERIAL_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/* std140 layout of MaterialBlock in shaders/material_incl.frag */
+struct MaterialBlock {
+  glm::vec4 baseColor;
+  float shininess;
+  float padding[3];
+};
+
+static_assert(sizeof(MaterialBlock) == 32);
+
+/* One uniform buffer holding a MaterialBlock per material, each at an
+   offset the driver can bind on its own. Switching materials is then a
+   glBindBufferRange instead of a round of uniform uploads. Slots are
+   handed out without a GL context; the buffer is created and doubled on
+   the GL thread as slots get written. */
+class MaterialBuffer {
+ private:
+  GLuint buffer;
+  /* Slot size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT */
+  size_t stride;
+  size_t capacity;
+  size_t slotCount;
+  std::vector<size_t> freeSlots;
+  bool initialized;
+
+  void initGL();
+  void reserve(size_t slots);
+
+ public:
+  static constexpr GLuint BINDING = 0;
+  static constexpr const char* BLOCK_NAME = "MaterialBlock";
+  static constexpr size_t INITIAL_CAPACITY = 64;
+
+  MaterialBuffer();
+  ~MaterialBuffer();
+
+  MaterialBuffer(const MaterialBuffer&) = delete;
+  MaterialBuffer& operator=(const MaterialBuffer&) = delete;
+
+  /* Buffer shared by all live materials; it's released with the last of
+     them, before the GL context goes away */
+  static std::shared_ptr<MaterialBuffer> acquire();
+
+  size_t allocate();
+  void release(size_t slot);
+
+  void write(size_t slot, const MaterialBlock& block);
+  /* Binds the slot's range at BINDING */
+  void bind(size_t slot);
+};
+
+#endif /* MATERIAL_BUFFER_H */
@@ -1,38 +1,187 @@
 #include "src/mesh.h"
 
+#include <cstring>
+
 #include "src/logger.h"
 
-Mesh::Mesh(const std::vector<Vertex>& vertices,
-           const std::vector<unsigned int>& indices)
-    : vertices(vertices), indices(indices) {
-  indicesCount = indices.size();
+GLenum selectIndexType(size_t verticesCount) {
+  return verticesCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t indexTypeSize(GLenum indexType) {
+  return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                        : sizeof(unsigned int);
+}
+
+std::vector<std::byte> packIndices(const std::vector<unsigned int>& indices,
+                                   GLenum indexType) {
+  std::vector<std::byte> data(indices.size() * indexTypeSize(indexType));
+  if (indexType == GL_UNSIGNED_SHORT) {
+    for (size_t i = 0; i < indices.size(); i++) {
+      uint16_t index = static_cast<uint16_t>(indices[i]);
+      std::memcpy(data.data() + i * sizeof(uint16_t), &index,
+                  sizeof(uint16_t));
+    }
+  } else {
+    std::memcpy(data.data(), indices.data(), data.size());
+  }
+  return data;
+}
+
+void computeBoundingSphere(const std::vector<Vertex>& vertices,
+                           glm::vec3& center, float& radius) {
+  if (vertices.empty()) {
+    center = glm::vec3(0.0F);
+    radius = 0.0F;
+    return;
+  }
+
+  glm::vec3 minPos = vertices[0].position;
+  glm::vec3 maxPos = vertices[0].position;
+  for (const Vertex& vertex : vertices) {
+    minPos = glm::min(minPos, vertex.position);
+    maxPos = glm::max(maxPos, vertex.position);
+  }
+  center = (minPos + maxPos) * 0.5F;
+  radius = glm::length(maxPos - center);
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
+           MeshResidency residency, VertexFormat format,
+           std::shared_ptr<MeshPool> pool, std::vector<MeshLod> lods)
+    : verticesCount(vertices.size()),
+      indicesCount(indices.size()),
+      residency(residency),
+      format(format),
+      indexType(selectIndexType(vertices.size())),
+      vertices(std::move(vertices)),
+      indices(std::move(indices)),
+      pool(nullptr),
+      lods(std::move(lods)) {
+  computeBounds();
+  if (this->lods.empty()) {
+    this->lods.push_back({0, indicesCount, 0.0F});
+  }
+
+  if (format != VertexFormat::FLOAT32 && !fitsCompactFormat(this->vertices)) {
+    LOG_WARNING("Mesh doesn't fit compact vertex format, using FLOAT32");
+    this->format = VertexFormat::FLOAT32;
+  }
+
+  MeshGpuData data;
+  data.format = this->format;
+  data.indexType = indexType;
+  data.verticesCount = verticesCount;
+  data.indicesCount = indicesCount;
+  data.vertexData = this->vertices.data();
+  data.indexData = this->indices.data();
+  data.boundsCenter = boundsCenter;
+  data.boundsRadius = boundsRadius;
+  std::vector<std::byte> packedVertices;
+  if (this->format != VertexFormat::FLOAT32) {
+    packedVertices = packVertices(this->vertices, this->format);
+    data.vertexData = packedVertices.data();
+  }
+  std::vector<std::byte> packedIndices;
+  if (indexType != GL_UNSIGNED_INT) {
+    packedIndices = packIndices(this->indices, indexType);
+    data.indexData = packedIndices.data();
+  }
+  upload(data, std::move(pool));
+
+  if (residency == MeshResidency::GPU_ONLY) {
+    std::vector<Vertex>().swap(this->vertices);
+    std::vector<unsigned int>().swap(this->indices);
+  }
+}
+
+Mesh::Mesh(const MeshGpuData& data, std::shared_ptr<MeshPool> pool)
+    : verticesCount(data.verticesCount),
+      indicesCount(data.indicesCount),
+      residency(MeshResidency::GPU_ONLY),
+      format(data.format),
+      indexType(data.indexType),
+      boundsCenter(data.boundsCenter),
+      boundsRadius(data.boundsRadius),
+      pool(nullptr),
+      lods(data.lods, data.lods + data.lodCount) {
+  if (lods.empty()) {
+    lods.push_back({0, indicesCount, 0.0F});
+  }
+  upload(data, std::move(pool));
+}
+
+void Mesh::upload(const MeshGpuData& data,
+                  std::shared_ptr<MeshPool> targetPool) {
+  if (targetPool) {
+    pool = std::move(targetPool);
+    poolAllocation = pool->allocate(data);
+    VAO = VBO = EBO = 0;
+    return;
+  }
 
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
   glGenBuffers(1, &EBO);
 
-  glBindVertexArray(VAO);
+  bindVertexArray(VAO);
 
+  const VertexLayout& layout = vertexFormatLayout(data.format);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
-               vertices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, data.verticesCount * layout.stride,
+               data.vertexData, GL_STATIC_DRAW);
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-               indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               data.indicesCount * indexTypeSize(data.indexType),
+               data.indexData, GL_STATIC_DRAW);
+
+  layout.enable();
+  bindVertexArray(0);
+}
 
-  Vertex::enableVertexAttribArray();
-  glBindVertexArray(0);
+MeshMemoryStats Mesh::getMemoryStats() const {
+  MeshMemoryStats stats;
+  stats.cpuBytes = vertices.capacity() * sizeof(Vertex) +
+                   indices.capacity() * sizeof(unsigned int);
+  stats.gpuBytes = verticesCount * vertexFormatLayout(format).stride +
+                   indicesCount * getIndexSize();
+  return stats;
+}
+
+void Mesh::computeBounds() {
+  computeBoundingSphere(vertices, boundsCenter, boundsRadius);
 }
 
 void Mesh::draw() {
-  glBindVertexArray(VAO);
-  glDrawElements(GL_TRIANGLES, indicesCount, GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+  drawLod(0);
+}
+
+void Mesh::drawLod(size_t lod) {
+  const MeshLod& level = getLod(lod);
+  size_t offset = level.firstIndex * getIndexSize();
+
+  if (pool) {
+    /* The shared VAO stays bound, so following pooled meshes of the same
+       format skip the bind */
+    pool->bind(format);
+    glDrawElementsBaseVertex(GL_TRIANGLES, level.indicesCount, indexType,
+                             (void*)(poolAllocation.indexOffset + offset),
+                             poolAllocation.baseVertex);
+    return;
+  }
+
+  bindVertexArray(VAO);
+  glDrawElements(GL_TRIANGLES, level.indicesCount, indexType, (void*)offset);
+  bindVertexArray(0);
 }
 
 Mesh::~Mesh() {
-  glDeleteVertexArrays(1, &VAO);
+  if (pool) {
+    pool->release(poolAllocation);
+    return;
+  }
+  deleteVertexArray(VAO);
   glDeleteBuffers(1, &VBO);
   glDeleteBuffers(1, &EBO);
 }
@@ -1,12 +1,63 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <GL/glew.h>
 
+#include "src/mesh_pool.h"
 #include "src/vertex.h"
+#include "src/vertex_formats.h"
+
+enum class MeshResidency {
+  /* Keep vertices and indices in RAM, e.g. for later CPU-side processing */
+  CPU_AND_GPU,
+  /* Free the CPU copies once they are uploaded, keeping counts and bounds */
+  GPU_ONLY,
+};
+
+struct MeshMemoryStats {
+  size_t cpuBytes;
+  size_t gpuBytes;
+};
+
+/* One level of detail: a range of the mesh's index buffer over the shared
+   vertices, and the geometric error (in mesh units) it introduces */
+struct MeshLod {
+  size_t firstIndex;
+  size_t indicesCount;
+  float error;
+};
+
+/* Buffer contents ready for glBufferData, e.g. from a memory-mapped mesh
+   cache. The pointers only have to stay valid during the Mesh constructor */
+struct MeshGpuData {
+  VertexFormat format;
+  GLenum indexType;
+  size_t verticesCount;
+  size_t indicesCount;
+  const void* vertexData;
+  const void* indexData;
+  glm::vec3 boundsCenter;
+  float boundsRadius;
+  /* Optional, without LODs the whole index buffer is LOD 0 */
+  const MeshLod* lods = nullptr;
+  size_t lodCount = 0;
+};
+
+/* GL_UNSIGNED_SHORT when every vertex is addressable with 16 bits */
+GLenum selectIndexType(size_t verticesCount);
+size_t indexTypeSize(GLenum indexType);
+std::vector<std::byte> packIndices(const std::vector<unsigned int>& indices,
+                                   GLenum indexType);
+
+/* Sphere around the AABB; not minimal, but cheap and good enough */
+void computeBoundingSphere(const std::vector<Vertex>& vertices,
+                           glm::vec3& center, float& radius);
 
 class Mesh {
  protected:
@@ -14,16 +65,75 @@ class Mesh {
   GLuint VAO;
   GLuint VBO;
   GLuint EBO;
+  size_t verticesCount;
+  /* Stored indices, including every LOD */
   size_t indicesCount;
+  MeshResidency residency;
+  VertexFormat format;
+  /* GL_UNSIGNED_SHORT when every index fits, GL_UNSIGNED_INT otherwise */
+  GLenum indexType;
 
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
 
+  /* Local-space bounding sphere */
+  glm::vec3 boundsCenter;
+  float boundsRadius;
+
+  /* Set when the buffers live in a shared MeshPool instead of VAO/VBO/EBO */
+  std::shared_ptr<MeshPool> pool;
+  MeshPoolAllocation poolAllocation;
+
+  /* Finest first, never empty */
+  std::vector<MeshLod> lods;
+
+  void computeBounds();
+
+ private:
+  void upload(const MeshGpuData& data, std::shared_ptr<MeshPool> targetPool);
+
  public:
-  Mesh(const std::vector<Vertex>& vertices,
-       const std::vector<unsigned int>& indices);
+  /* Takes the buffers by value, so callers can move them in without a copy.
+     Vertices are packed into `format` for upload; meshes that don't fit a
+     compact format fall back to FLOAT32. With a pool the mesh is
+     suballocated from its shared buffers, which it keeps alive. lods
+     describe ranges of indices, by default all of it is LOD 0 */
+  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
+       MeshResidency residency = MeshResidency::CPU_AND_GPU,
+       VertexFormat format = VertexFormat::FLOAT32,
+       std::shared_ptr<MeshPool> pool = nullptr,
+       std::vector<MeshLod> lods = {});
+  /* Uploads already packed data; such meshes are always GPU_ONLY */
+  explicit Mesh(const MeshGpuData& data,
+                std::shared_ptr<MeshPool> pool = nullptr);
 
   virtual void draw();
+  /* Draws one level of detail, clamped to the coarsest available */
+  void drawLod(size_t lod);
+
+  const glm::vec3& getBoundsCenter() const { return boundsCenter; }
+  float getBoundsRadius() const { return boundsRadius; }
+
+  size_t getVerticesCount() const { return verticesCount; }
+  /* Indices of LOD 0 */
+  size_t getIndicesCount() const { return lods[0].indicesCount; }
+  size_t getLodCount() const { return lods.size(); }
+  const MeshLod& getLod(size_t lod) const {
+    return lods[std::min(lod, lods.size() - 1)];
+  }
+  MeshResidency getResidency() const { return residency; }
+  VertexFormat getVertexFormat() const { return format; }
+  GLenum getIndexType() const { return indexType; }
+  size_t getIndexSize() const { return indexTypeSize(indexType); }
+  bool hasCpuData() const { return residency == MeshResidency::CPU_AND_GPU; }
+
+  bool isPooled() const { return pool != nullptr; }
+  MeshPool* getPool() const { return pool.get(); }
+  const MeshPoolAllocation& getPoolAllocation() const {
+    return poolAllocation;
+  }
+
+  virtual MeshMemoryStats getMemoryStats() const;
 
   const std::string& getName() const { return name; }
   void setName(const std::string& n) { name = n; }
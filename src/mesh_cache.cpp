@@ -0,0 +1,232 @@
+#include "src/mesh_cache.h"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/exceptions.h"
+#include "src/logger.h"
+
+static constexpr char MESH_CACHE_MAGIC[4] = {'M', 'S', 'H', 'C'};
+
+struct MeshCacheHeader {
+  char magic[4];
+  uint32_t version;
+  /* Format the vertices were built in, FLOAT32 when requestedFormat
+     didn't fit */
+  uint32_t vertexFormat;
+  uint32_t indexType;
+  uint32_t requestedFormat;
+  uint32_t padding;
+  uint64_t sourceSize;
+  int64_t sourceModified;
+  uint64_t verticesCount;
+  uint64_t indicesCount;
+  uint64_t vertexOffset;
+  uint64_t vertexBytes;
+  uint64_t indexOffset;
+  uint64_t indexBytes;
+  uint64_t lodOffset;
+  uint64_t lodCount;
+  float boundsCenter[3];
+  float boundsRadius;
+};
+
+struct MeshCacheLod {
+  uint64_t firstIndex;
+  uint64_t indicesCount;
+  float error;
+  uint32_t padding;
+};
+
+static_assert(std::is_trivially_copyable_v<MeshCacheHeader>);
+static_assert(sizeof(MeshCacheHeader) % 8 == 0);
+
+/* Fields are stored in host order, which is only the file order on
+   little-endian hosts; elsewhere the cache is simply not used */
+static constexpr bool CACHE_SUPPORTED =
+    std::endian::native == std::endian::little;
+
+static uint64_t alignUp(uint64_t value) {
+  return (value + MeshCache::CACHE_ALIGNMENT - 1) /
+         MeshCache::CACHE_ALIGNMENT * MeshCache::CACHE_ALIGNMENT;
+}
+
+MeshCache::MeshCache(void* mapping, size_t mappingSize,
+                     std::vector<MeshLod> lods, const MeshGpuData& data)
+    : mapping(mapping),
+      mappingSize(mappingSize),
+      lods(std::move(lods)),
+      data(data) {
+  this->data.lods = this->lods.data();
+  this->data.lodCount = this->lods.size();
+}
+
+MeshCache::~MeshCache() {
+  munmap(mapping, mappingSize);
+}
+
+MeshCacheKey MeshCache::keyFor(const std::filesystem::path& source,
+                               VertexFormat format) {
+  MeshCacheKey key;
+  key.sourceSize = std::filesystem::file_size(source);
+  key.sourceModified =
+      std::filesystem::last_write_time(source).time_since_epoch().count();
+  key.format = format;
+  return key;
+}
+
+std::filesystem::path MeshCache::pathFor(
+    const std::filesystem::path& source) {
+  std::filesystem::path path = source;
+  path += ".meshcache";
+  return path;
+}
+
+std::unique_ptr<MeshCache> MeshCache::open(const std::filesystem::path& path,
+                                           const MeshCacheKey& key) {
+  if (!CACHE_SUPPORTED) {
+    return nullptr;
+  }
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 ||
+      static_cast<size_t>(fileStat.st_size) < sizeof(MeshCacheHeader)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(fileStat.st_size);
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* The mapping keeps the file referenced */
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG_WARNING("Cannot map mesh cache ", path, ": ", strerror(errno));
+    return nullptr;
+  }
+
+  MeshCacheHeader header;
+  std::memcpy(&header, mapping, sizeof(header));
+
+  VertexFormat format = static_cast<VertexFormat>(header.vertexFormat);
+  bool valid =
+      std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.version == VERSION && header.sourceSize == key.sourceSize &&
+      header.sourceModified == key.sourceModified &&
+      header.vertexFormat <= static_cast<uint32_t>(VertexFormat::OCTAHEDRAL) &&
+      (header.indexType == GL_UNSIGNED_SHORT ||
+       header.indexType == GL_UNSIGNED_INT);
+  if (valid) {
+    /* The built format may have fallen back to FLOAT32 */
+    valid = header.requestedFormat == static_cast<uint32_t>(key.format) &&
+            (format == key.format || format == VertexFormat::FLOAT32) &&
+            header.vertexBytes ==
+                header.verticesCount * vertexFormatLayout(format).stride &&
+            header.indexBytes ==
+                header.indicesCount * indexTypeSize(header.indexType) &&
+            header.vertexOffset <= size &&
+            header.vertexBytes <= size - header.vertexOffset &&
+            header.indexOffset <= size &&
+            header.indexBytes <= size - header.indexOffset &&
+            header.lodOffset <= size &&
+            header.lodCount <= (size - header.lodOffset) / sizeof(MeshCacheLod);
+  }
+  if (!valid) {
+    LOG_INFO("Mesh cache ", path, " is stale, rebuilding");
+    munmap(mapping, size);
+    return nullptr;
+  }
+
+  const std::byte* bytes = static_cast<const std::byte*>(mapping);
+  std::vector<MeshLod> lods(header.lodCount);
+  for (size_t i = 0; i < lods.size(); i++) {
+    MeshCacheLod lod;
+    std::memcpy(&lod, bytes + header.lodOffset + i * sizeof(lod), sizeof(lod));
+    if (lod.firstIndex + lod.indicesCount > header.indicesCount) {
+      LOG_INFO("Mesh cache ", path, " has invalid LODs, rebuilding");
+      munmap(mapping, size);
+      return nullptr;
+    }
+    lods[i] = {lod.firstIndex, lod.indicesCount, lod.error};
+  }
+
+  MeshGpuData data;
+  data.format = format;
+  data.indexType = header.indexType;
+  data.verticesCount = header.verticesCount;
+  data.indicesCount = header.indicesCount;
+  data.vertexData = bytes + header.vertexOffset;
+  data.indexData = bytes + header.indexOffset;
+  data.boundsCenter = glm::vec3(header.boundsCenter[0], header.boundsCenter[1],
+                                header.boundsCenter[2]);
+  data.boundsRadius = header.boundsRadius;
+
+  return std::unique_ptr<MeshCache>(
+      new MeshCache(mapping, size, std::move(lods), data));
+}
+
+void MeshCache::write(const std::filesystem::path& path,
+                      const MeshCacheKey& key, const MeshGpuData& data) {
+  if (!CACHE_SUPPORTED) {
+    return;
+  }
+
+  MeshCacheHeader header = {};
+  std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+  header.version = VERSION;
+  header.vertexFormat = static_cast<uint32_t>(data.format);
+  header.indexType = data.indexType;
+  header.requestedFormat = static_cast<uint32_t>(key.format);
+  header.sourceSize = key.sourceSize;
+  header.sourceModified = key.sourceModified;
+  header.verticesCount = data.verticesCount;
+  header.indicesCount = data.indicesCount;
+  header.vertexBytes =
+      data.verticesCount * vertexFormatLayout(data.format).stride;
+  header.indexBytes = data.indicesCount * indexTypeSize(data.indexType);
+  header.vertexOffset = alignUp(sizeof(MeshCacheHeader));
+  header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes);
+  header.lodOffset = alignUp(header.indexOffset + header.indexBytes);
+  header.lodCount = data.lodCount;
+  header.boundsCenter[0] = data.boundsCenter.x;
+  header.boundsCenter[1] = data.boundsCenter.y;
+  header.boundsCenter[2] = data.boundsCenter.z;
+  header.boundsRadius = data.boundsRadius;
+
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw ResourceException("Cannot write mesh cache " + tempPath.string());
+    }
+    const char zeros[CACHE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(zeros, header.vertexOffset - sizeof(header));
+    file.write(static_cast<const char*>(data.vertexData), header.vertexBytes);
+    file.write(zeros,
+               header.indexOffset - header.vertexOffset - header.vertexBytes);
+    file.write(static_cast<const char*>(data.indexData), header.indexBytes);
+    file.write(zeros,
+               header.lodOffset - header.indexOffset - header.indexBytes);
+    for (size_t i = 0; i < data.lodCount; i++) {
+      MeshCacheLod lod = {data.lods[i].firstIndex, data.lods[i].indicesCount,
+                          data.lods[i].error, 0};
+      file.write(reinterpret_cast<const char*>(&lod), sizeof(lod));
+    }
+    if (!file) {
+      throw ResourceException("Failed writing mesh cache " +
+                              tempPath.string());
+    }
+  }
+  std::filesystem::rename(tempPath, path);
+}
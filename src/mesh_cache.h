@@ -0,0 +1,64 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "src/mesh.h"
+
+/* Identifies the source a cache file was built from; a cache whose key
+   doesn't match is stale and gets rebuilt */
+struct MeshCacheKey {
+  uint64_t sourceSize;
+  int64_t sourceModified;
+  VertexFormat format;
+};
+
+/* Binary, little-endian mesh cache file:
+
+     MeshCacheHeader | pad | vertex blob | pad | index blob | pad | LODs
+
+   Blobs start at CACHE_ALIGNMENT boundaries and hold exactly what
+   glBufferData consumes, so a mapped file is uploaded without parsing.
+   Bump VERSION whenever the header or a vertex format changes. */
+class MeshCache {
+ private:
+  void* mapping;
+  size_t mappingSize;
+  std::vector<MeshLod> lods;
+  MeshGpuData data;
+
+  MeshCache(void* mapping, size_t mappingSize, std::vector<MeshLod> lods,
+            const MeshGpuData& data);
+
+ public:
+  static constexpr uint32_t VERSION = 3;
+  static constexpr size_t CACHE_ALIGNMENT = 64;
+
+  /* Maps the cache file; returns nullptr if it is missing, stale or from
+     another version */
+  static std::unique_ptr<MeshCache> open(const std::filesystem::path& path,
+                                         const MeshCacheKey& key);
+
+  /* Writes to a temporary file and renames it over path */
+  static void write(const std::filesystem::path& path, const MeshCacheKey& key,
+                    const MeshGpuData& data);
+
+  static MeshCacheKey keyFor(const std::filesystem::path& source,
+                             VertexFormat format);
+
+  /* Caches live next to their source as <source>.meshcache */
+  static std::filesystem::path pathFor(const std::filesystem::path& source);
+
+  MeshCache(const MeshCache&) = delete;
+  MeshCache& operator=(const MeshCache&) = delete;
+  ~MeshCache();
+
+  /* Points into the mapping, valid as long as this object lives */
+  const MeshGpuData& getData() const { return data; }
+};
+
+#endif /* MESH_CACHE_H */
@@ -0,0 +1,63 @@
+#include "src/mesh_cooker.h"
+
+#include "src/exceptions.h"
+#include "src/logger.h"
+#include "src/mesh_optimizer.h"
+#include "src/mesh_simplifier.h"
+
+void optimizeAndReport(const std::string& name, std::vector<Vertex>& vertices,
+                       std::vector<unsigned int>& indices) {
+  MeshOptimizationStats stats = optimizeMesh(vertices, indices);
+  LOG_INFO("Optimized mesh '", name, "': ", stats.verticesBefore, " -> ",
+           stats.verticesAfter, " vertices, ACMR ", stats.before.acmr, " -> ",
+           stats.after.acmr, ", ATVR ", stats.before.atvr, " -> ",
+           stats.after.atvr);
+}
+
+CookedMesh cookMesh(const std::string& name, MeshData mesh,
+                    VertexFormat format) {
+  optimizeAndReport(name, mesh.vertices, mesh.indices);
+
+  CookedMesh cooked;
+  cooked.lods = buildLodChain(mesh.vertices, mesh.indices);
+  LOG_INFO("Model '", name, "' has ", cooked.lods.size(), " LODs, coarsest ",
+           cooked.lods.back().indicesCount / 3, " triangles");
+
+  MeshGpuData& data = cooked.data;
+  data.format = format;
+  if (format != VertexFormat::FLOAT32 && !fitsCompactFormat(mesh.vertices)) {
+    LOG_WARNING("Model '", name, "' doesn't fit compact vertex format");
+    data.format = VertexFormat::FLOAT32;
+  }
+  data.indexType = selectIndexType(mesh.vertices.size());
+  data.verticesCount = mesh.vertices.size();
+  data.indicesCount = mesh.indices.size();
+  cooked.vertexData = packVertices(mesh.vertices, data.format);
+  cooked.indexData = packIndices(mesh.indices, data.indexType);
+  data.vertexData = cooked.vertexData.data();
+  data.indexData = cooked.indexData.data();
+  computeBoundingSphere(mesh.vertices, data.boundsCenter, data.boundsRadius);
+  data.lods = cooked.lods.data();
+  data.lodCount = cooked.lods.size();
+  return cooked;
+}
+
+CookedMesh cookModel(const std::string& name,
+                     const std::filesystem::path& path,
+                     const MeshCacheKey& key) {
+  if (path.extension() != ".obj") {
+    throw NotImplementedException("Unsupported model format " +
+                                  path.extension().string());
+  }
+
+  CookedMesh cooked = cookMesh(name, loadObj(path), key.format);
+
+  std::filesystem::path cachePath = MeshCache::pathFor(path);
+  try {
+    MeshCache::write(cachePath, key, cooked.data);
+  } catch (const std::exception& e) {
+    /* Not fatal, the next run just parses again */
+    LOG_WARNING("Failed to write mesh cache ", cachePath, ": ", e.what());
+  }
+  return cooked;
+}
@@ -0,0 +1,45 @@
+#ifndef MESH_COOKER_H
+#define MESH_COOKER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "src/mesh.h"
+#include "src/mesh_cache.h"
+#include "src/obj_loader.h"
+
+/* A model ready for upload. data points into the other members, which a
+   move keeps valid but a copy would not. */
+struct CookedMesh {
+  std::vector<std::byte> vertexData;
+  std::vector<std::byte> indexData;
+  std::vector<MeshLod> lods;
+  MeshGpuData data;
+
+  CookedMesh() = default;
+  CookedMesh(CookedMesh&&) = default;
+  CookedMesh& operator=(CookedMesh&&) = default;
+  CookedMesh(const CookedMesh&) = delete;
+  CookedMesh& operator=(const CookedMesh&) = delete;
+};
+
+/* Runs optimizeMesh() and logs what it gained */
+void optimizeAndReport(const std::string& name, std::vector<Vertex>& vertices,
+                       std::vector<unsigned int>& indices);
+
+/* Optimizes the mesh, appends its LOD chain and packs it into format,
+   falling back to FLOAT32 when it doesn't fit */
+CookedMesh cookMesh(const std::string& name, MeshData mesh,
+                    VertexFormat format);
+
+/* Imports an OBJ model, cooks it into key.format and writes
+   MeshCache::pathFor(path) under key, so ResourceManager::loadModel maps
+   it instead of importing. Throws when the model can't be read; a failed
+   cache write is only logged. */
+CookedMesh cookModel(const std::string& name,
+                     const std::filesystem::path& path,
+                     const MeshCacheKey& key);
+
+#endif /* MESH_COOKER_H */
@@ -0,0 +1,254 @@
+#include "src/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+/* Forsyth's tuning constants, see "Linear-Speed Vertex Cache Optimisation" */
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+static constexpr float CACHE_DECAY_POWER = 1.5F;
+static constexpr float LAST_TRIANGLE_SCORE = 0.75F;
+static constexpr float VALENCE_BOOST_SCALE = 2.0F;
+static constexpr float VALENCE_BOOST_POWER = 0.5F;
+
+static constexpr unsigned int UNASSIGNED =
+    std::numeric_limits<unsigned int>::max();
+
+struct VertexBitsHash {
+  size_t operator()(const Vertex& vertex) const {
+    /* FNV-1a over the raw bytes, Vertex is tightly packed floats */
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(Vertex); i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+struct VertexBitsEqual {
+  bool operator()(const Vertex& a, const Vertex& b) const {
+    return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+  }
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices,
+                                    size_t verticesCount, size_t cacheSize) {
+  VertexCacheStats stats = {0.0F, 0.0F};
+  if (indices.size() < 3 || verticesCount == 0) {
+    return stats;
+  }
+
+  /* FIFO: a vertex is a hit if it entered the cache at most cacheSize
+     misses ago */
+  std::vector<size_t> insertedAt(verticesCount, 0);
+  size_t misses = 0;
+  for (unsigned int index : indices) {
+    if (insertedAt[index] == 0 || misses - insertedAt[index] >= cacheSize) {
+      misses++;
+      insertedAt[index] = misses;
+    }
+  }
+
+  stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / verticesCount;
+  return stats;
+}
+
+void weldVertices(std::vector<Vertex>& vertices,
+                  std::vector<unsigned int>& indices) {
+  std::unordered_map<Vertex, unsigned int, VertexBitsHash, VertexBitsEqual>
+      unique;
+  unique.reserve(vertices.size());
+
+  std::vector<unsigned int> remap(vertices.size());
+  std::vector<Vertex> welded;
+  welded.reserve(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    auto [it, inserted] =
+        unique.try_emplace(vertices[i], static_cast<unsigned int>(welded.size()));
+    if (inserted) {
+      welded.push_back(vertices[i]);
+    }
+    remap[i] = it->second;
+  }
+
+  for (unsigned int& index : indices) {
+    index = remap[index];
+  }
+  vertices = std::move(welded);
+}
+
+static float forsythVertexScore(int cachePosition, int remainingTriangles) {
+  if (remainingTriangles == 0) {
+    return -1.0F;
+  }
+
+  float score = 0.0F;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      /* Used by the last triangle; a fixed score so the optimizer doesn't
+         simply pick the same strip direction */
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      float scale = 1.0F / (FORSYTH_CACHE_SIZE - 3);
+      score = std::pow(1.0F - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+    }
+  }
+
+  /* Prefer vertices with few triangles left, to finish them off */
+  score += VALENCE_BOOST_SCALE *
+           std::pow(static_cast<float>(remainingTriangles),
+                    -VALENCE_BOOST_POWER);
+  return score;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices,
+                         size_t verticesCount) {
+  size_t trianglesCount = indices.size() / 3;
+  if (trianglesCount == 0) {
+    return;
+  }
+
+  /* Vertex -> triangles adjacency in CSR form; remaining[v] is the number of
+     not yet emitted triangles at the front of v's slice */
+  std::vector<unsigned int> offsets(verticesCount + 1, 0);
+  for (unsigned int index : indices) {
+    offsets[index + 1]++;
+  }
+  for (size_t v = 0; v < verticesCount; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<int> remaining(verticesCount, 0);
+  for (size_t i = 0; i < indices.size(); i++) {
+    unsigned int v = indices[i];
+    adjacency[offsets[v] + remaining[v]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  std::vector<int> cachePosition(verticesCount, -1);
+  std::vector<float> vertexScore(verticesCount);
+  for (size_t v = 0; v < verticesCount; v++) {
+    vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+  }
+
+  std::vector<float> triangleScore(trianglesCount);
+  std::vector<bool> emitted(trianglesCount, false);
+  unsigned int bestTriangle = 0;
+  for (size_t t = 0; t < trianglesCount; t++) {
+    triangleScore[t] = vertexScore[indices[t * 3]] +
+                       vertexScore[indices[t * 3 + 1]] +
+                       vertexScore[indices[t * 3 + 2]];
+    if (triangleScore[t] > triangleScore[bestTriangle]) {
+      bestTriangle = static_cast<unsigned int>(t);
+    }
+  }
+
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> newCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+  size_t scanCursor = 0;
+
+  for (size_t emittedCount = 0; emittedCount < trianglesCount;
+       emittedCount++) {
+    const unsigned int* triangle = &indices[bestTriangle * 3];
+    result.insert(result.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = true;
+
+    /* Remove the triangle from its vertices' remaining lists */
+    for (int k = 0; k < 3; k++) {
+      unsigned int v = triangle[k];
+      unsigned int* begin = &adjacency[offsets[v]];
+      unsigned int* end = begin + remaining[v];
+      unsigned int* found = std::find(begin, end, bestTriangle);
+      if (found != end) {
+        std::swap(*found, *(end - 1));
+        remaining[v]--;
+      }
+    }
+
+    /* The triangle's vertices move to the front of the LRU cache */
+    newCache.assign(triangle, triangle + 3);
+    for (unsigned int v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        newCache.push_back(v);
+      }
+    }
+
+    for (size_t i = 0; i < newCache.size(); i++) {
+      unsigned int v = newCache[i];
+      cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+      vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+    }
+
+    /* Rescore the triangles touching the cache and pick the best one */
+    float bestScore = -1.0F;
+    for (unsigned int v : newCache) {
+      for (int j = 0; j < remaining[v]; j++) {
+        unsigned int t = adjacency[offsets[v] + j];
+        triangleScore[t] = vertexScore[indices[t * 3]] +
+                           vertexScore[indices[t * 3 + 1]] +
+                           vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          bestTriangle = t;
+        }
+      }
+    }
+
+    if (newCache.size() > FORSYTH_CACHE_SIZE) {
+      newCache.resize(FORSYTH_CACHE_SIZE);
+    }
+    std::swap(cache, newCache);
+
+    if (bestScore < 0.0F) {
+      /* Nothing adjacent to the cache is left, continue anywhere */
+      while (scanCursor < trianglesCount && emitted[scanCursor]) {
+        scanCursor++;
+      }
+      bestTriangle = static_cast<unsigned int>(scanCursor);
+    }
+  }
+
+  indices = std::move(result);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices,
+                         std::vector<unsigned int>& indices) {
+  std::vector<unsigned int> remap(vertices.size(), UNASSIGNED);
+  std::vector<Vertex> reordered;
+  reordered.reserve(vertices.size());
+
+  for (unsigned int& index : indices) {
+    if (remap[index] == UNASSIGNED) {
+      remap[index] = static_cast<unsigned int>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices = std::move(reordered);
+}
+
+MeshOptimizationStats optimizeMesh(std::vector<Vertex>& vertices,
+                                   std::vector<unsigned int>& indices) {
+  MeshOptimizationStats stats;
+  stats.verticesBefore = vertices.size();
+  stats.before = analyzeVertexCache(indices, vertices.size());
+
+  weldVertices(vertices, indices);
+  if (indices.size() % 3 == 0) {
+    optimizeVertexCache(indices, vertices.size());
+  }
+  optimizeVertexFetch(vertices, indices);
+
+  stats.verticesAfter = vertices.size();
+  stats.after = analyzeVertexCache(indices, vertices.size());
+  return stats;
+}
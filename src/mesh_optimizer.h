@@ -0,0 +1,46 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "src/vertex.h"
+
+/* Post-transform vertex cache efficiency of an index buffer.
+   ACMR: transformed vertices per triangle (0.5 is ideal for large grids)
+   ATVR: transformed vertices per unique vertex (1.0 is ideal) */
+struct VertexCacheStats {
+  float acmr;
+  float atvr;
+};
+
+struct MeshOptimizationStats {
+  size_t verticesBefore;
+  size_t verticesAfter;
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+/* Simulates a FIFO post-transform cache of the given size */
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices,
+                                    size_t verticesCount,
+                                    size_t cacheSize = 16);
+
+/* Merges bitwise identical vertices and rewrites the indices */
+void weldVertices(std::vector<Vertex>& vertices,
+                  std::vector<unsigned int>& indices);
+
+/* Reorders triangles for the post-transform cache (Tom Forsyth's linear-speed
+   vertex cache optimization) */
+void optimizeVertexCache(std::vector<unsigned int>& indices,
+                         size_t verticesCount);
+
+/* Reorders vertices in order of first use and drops unreferenced ones */
+void optimizeVertexFetch(std::vector<Vertex>& vertices,
+                         std::vector<unsigned int>& indices);
+
+/* Runs weld, cache and fetch optimization in that order */
+MeshOptimizationStats optimizeMesh(std::vector<Vertex>& vertices,
+                                   std::vector<unsigned int>& indices);
+
+#endif /* MESH_OPTIMIZER_H */
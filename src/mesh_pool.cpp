@@ -0,0 +1,202 @@
+#include "src/mesh_pool.h"
+
+#include <algorithm>
+
+#include "src/logger.h"
+#include "src/mesh.h"
+
+RangeAllocator::RangeAllocator(size_t capacity) : capacity(0) {
+  grow(capacity);
+}
+
+std::optional<size_t> RangeAllocator::allocate(size_t size) {
+  for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+    auto [offset, freeSize] = *it;
+    if (freeSize < size) {
+      continue;
+    }
+    freeRanges.erase(it);
+    if (freeSize > size) {
+      freeRanges.emplace(offset + size, freeSize - size);
+    }
+    return offset;
+  }
+  return std::nullopt;
+}
+
+void RangeAllocator::release(size_t offset, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  auto next = freeRanges.lower_bound(offset);
+  if (next != freeRanges.end() && offset + size == next->first) {
+    size += next->second;
+    next = freeRanges.erase(next);
+  }
+  if (next != freeRanges.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += size;
+      return;
+    }
+  }
+  freeRanges.emplace(offset, size);
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+  if (newCapacity <= capacity) {
+    return;
+  }
+  size_t oldCapacity = capacity;
+  capacity = newCapacity;
+  release(oldCapacity, newCapacity - oldCapacity);
+}
+
+GLuint MeshPoolAllocation::firstIndex() const {
+  return static_cast<GLuint>(indexOffset / indexTypeSize(indexType));
+}
+
+MeshPool::MeshPool(size_t initialVertexBytes, size_t initialIndexBytes)
+    : initialVertexBytes(initialVertexBytes),
+      initialIndexBytes(initialIndexBytes) {}
+
+MeshPool::~MeshPool() {
+  for (Arena& arena : arenas) {
+    if (arena.VAO) {
+      deleteVertexArray(arena.VAO);
+      glDeleteBuffers(1, &arena.VBO);
+      glDeleteBuffers(1, &arena.EBO);
+    }
+  }
+}
+
+MeshPool::Arena& MeshPool::getArena(VertexFormat format) {
+  Arena& arena = arenas[static_cast<size_t>(format)];
+  if (!arena.VAO) {
+    /* Created on first use, the pool may outlive or predate the context */
+    createArena(arena, format);
+  }
+  return arena;
+}
+
+void MeshPool::createArena(Arena& arena, VertexFormat format) {
+  const VertexLayout& layout = vertexFormatLayout(format);
+  size_t vertexCapacity = initialVertexBytes / layout.stride;
+  size_t indexCapacity = initialIndexBytes / INDEX_UNIT;
+
+  glGenVertexArrays(1, &arena.VAO);
+  glGenBuffers(1, &arena.VBO);
+  glGenBuffers(1, &arena.EBO);
+
+  bindVertexArray(arena.VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout.stride, nullptr,
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * INDEX_UNIT, nullptr,
+               GL_STATIC_DRAW);
+  layout.enable();
+
+  arena.vertexSpace = RangeAllocator(vertexCapacity);
+  arena.indexSpace = RangeAllocator(indexCapacity);
+}
+
+/* Copies a buffer into a new, larger one and returns the new name */
+static GLuint growBuffer(GLuint buffer, size_t oldBytes, size_t newBytes) {
+  GLuint grown;
+  glGenBuffers(1, &grown);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                      oldBytes);
+  glDeleteBuffers(1, &buffer);
+  return grown;
+}
+
+void MeshPool::growVertexBuffer(Arena& arena, VertexFormat format,
+                                size_t minVertices) {
+  const VertexLayout& layout = vertexFormatLayout(format);
+  size_t oldCapacity = arena.vertexSpace.getCapacity();
+  size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + minVertices);
+  LOG_INFO("Growing mesh pool vertex buffer to ", newCapacity, " vertices");
+
+  arena.VBO = growBuffer(arena.VBO, oldCapacity * layout.stride,
+                         newCapacity * layout.stride);
+  /* Attribute pointers captured the old buffer */
+  bindVertexArray(arena.VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+  layout.enable();
+  arena.vertexSpace.grow(newCapacity);
+}
+
+void MeshPool::growIndexBuffer(Arena& arena, size_t minUnits) {
+  size_t oldCapacity = arena.indexSpace.getCapacity();
+  size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + minUnits);
+  LOG_INFO("Growing mesh pool index buffer to ", newCapacity * INDEX_UNIT,
+           " bytes");
+
+  arena.EBO = growBuffer(arena.EBO, oldCapacity * INDEX_UNIT,
+                         newCapacity * INDEX_UNIT);
+  bindVertexArray(arena.VAO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.EBO);
+  arena.indexSpace.grow(newCapacity);
+}
+
+MeshPoolAllocation MeshPool::allocate(const MeshGpuData& data) {
+  Arena& arena = getArena(data.format);
+  const VertexLayout& layout = vertexFormatLayout(data.format);
+  size_t indexBytes = data.indicesCount * indexTypeSize(data.indexType);
+  size_t indexUnits = (indexBytes + INDEX_UNIT - 1) / INDEX_UNIT;
+
+  std::optional<size_t> vertexOffset =
+      arena.vertexSpace.allocate(data.verticesCount);
+  if (!vertexOffset) {
+    growVertexBuffer(arena, data.format, data.verticesCount);
+    vertexOffset = arena.vertexSpace.allocate(data.verticesCount);
+  }
+  std::optional<size_t> indexOffset = arena.indexSpace.allocate(indexUnits);
+  if (!indexOffset) {
+    growIndexBuffer(arena, indexUnits);
+    indexOffset = arena.indexSpace.allocate(indexUnits);
+  }
+
+  MeshPoolAllocation allocation;
+  allocation.format = data.format;
+  allocation.indexType = data.indexType;
+  allocation.baseVertex = static_cast<GLint>(*vertexOffset);
+  allocation.verticesCount = data.verticesCount;
+  allocation.indexOffset = *indexOffset * INDEX_UNIT;
+  allocation.indicesCount = data.indicesCount;
+
+  glBindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+  glBufferSubData(GL_ARRAY_BUFFER, *vertexOffset * layout.stride,
+                  data.verticesCount * layout.stride, data.vertexData);
+  /* The element buffer binding is VAO state, upload through another target */
+  glBindBuffer(GL_COPY_WRITE_BUFFER, arena.EBO);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, indexBytes,
+                  data.indexData);
+
+  return allocation;
+}
+
+void MeshPool::release(const MeshPoolAllocation& allocation) {
+  Arena& arena = arenas[static_cast<size_t>(allocation.format)];
+  size_t indexBytes =
+      allocation.indicesCount * indexTypeSize(allocation.indexType);
+  arena.vertexSpace.release(allocation.baseVertex, allocation.verticesCount);
+  arena.indexSpace.release(allocation.indexOffset / INDEX_UNIT,
+                           (indexBytes + INDEX_UNIT - 1) / INDEX_UNIT);
+}
+
+void MeshPool::bind(VertexFormat format) {
+  bindVertexArray(arenas[static_cast<size_t>(format)].VAO);
+}
+
+GLuint MeshPool::getVertexArray(VertexFormat format) const {
+  return arenas[static_cast<size_t>(format)].VAO;
+}
+
+GLuint MeshPool::getIndexBuffer(VertexFormat format) const {
+  return arenas[static_cast<size_t>(format)].EBO;
+}
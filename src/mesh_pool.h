@@ -0,0 +1,93 @@
+#ifndef MESH_POOL_H
+#define MESH_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <optional>
+
+#include <GL/glew.h>
+
+#include "src/vertex_formats.h"
+
+struct MeshGpuData;
+
+/* First-fit allocator over [0, capacity) in abstract units */
+class RangeAllocator {
+ private:
+  /* offset -> size of every free range, never adjacent to each other */
+  std::map<size_t, size_t> freeRanges;
+  size_t capacity;
+
+ public:
+  explicit RangeAllocator(size_t capacity = 0);
+
+  std::optional<size_t> allocate(size_t size);
+  void release(size_t offset, size_t size);
+  /* Appends [capacity, newCapacity) to the free space */
+  void grow(size_t newCapacity);
+
+  size_t getCapacity() const { return capacity; }
+};
+
+/* Where a pooled mesh lives inside the shared buffers of its layout */
+struct MeshPoolAllocation {
+  VertexFormat format;
+  GLenum indexType;
+  /* In vertices, passed as basevertex so indices stay mesh-relative */
+  GLint baseVertex;
+  size_t verticesCount;
+  /* Byte offset into the shared index buffer, a multiple of the index size */
+  size_t indexOffset;
+  size_t indicesCount;
+
+  /* Offset in indices, as DrawElementsIndirectCommand::firstIndex wants */
+  GLuint firstIndex() const;
+};
+
+/* Suballocates static meshes from a few large vertex/index buffers, one set
+   (and one VAO) per vertex format, so meshes sharing a format draw without
+   VAO switches. Buffers grow by doubling when full. */
+class MeshPool {
+ private:
+  struct Arena {
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    /* In vertices */
+    RangeAllocator vertexSpace;
+    /* In INDEX_UNIT bytes, so 16 and 32 bit indices can share one buffer */
+    RangeAllocator indexSpace;
+  };
+
+  static constexpr size_t FORMAT_COUNT = 3;
+  static constexpr size_t INDEX_UNIT = 4;
+
+  std::array<Arena, FORMAT_COUNT> arenas;
+  size_t initialVertexBytes;
+  size_t initialIndexBytes;
+
+  Arena& getArena(VertexFormat format);
+  void createArena(Arena& arena, VertexFormat format);
+  void growVertexBuffer(Arena& arena, VertexFormat format, size_t minVertices);
+  void growIndexBuffer(Arena& arena, size_t minUnits);
+
+ public:
+  explicit MeshPool(size_t initialVertexBytes = 16 << 20,
+                    size_t initialIndexBytes = 8 << 20);
+  ~MeshPool();
+
+  MeshPool(const MeshPool&) = delete;
+  MeshPool& operator=(const MeshPool&) = delete;
+
+  MeshPoolAllocation allocate(const MeshGpuData& data);
+  void release(const MeshPoolAllocation& allocation);
+
+  /* Binds the shared VAO of the format, if it isn't bound already */
+  void bind(VertexFormat format);
+
+  GLuint getVertexArray(VertexFormat format) const;
+  GLuint getIndexBuffer(VertexFormat format) const;
+};
+
+#endif /* MESH_POOL_H */
@@ -0,0 +1,256 @@
+#include "src/mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+
+#include "src/mesh_optimizer.h"
+
+/* Symmetric 4x4 matrix, upper triangle stored row by row */
+struct Quadric {
+  double m[10] = {};
+
+  void addPlane(double a, double b, double c, double d) {
+    m[0] += a * a;
+    m[1] += a * b;
+    m[2] += a * c;
+    m[3] += a * d;
+    m[4] += b * b;
+    m[5] += b * c;
+    m[6] += b * d;
+    m[7] += c * c;
+    m[8] += c * d;
+    m[9] += d * d;
+  }
+
+  Quadric& operator+=(const Quadric& other) {
+    for (int i = 0; i < 10; i++) {
+      m[i] += other.m[i];
+    }
+    return *this;
+  }
+
+  /* Sum of squared distances of p to the accumulated planes */
+  double evaluate(const glm::vec3& p) const {
+    double x = p.x, y = p.y, z = p.z;
+    return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z +
+           2 * m[3] * x + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+           m[7] * z * z + 2 * m[8] * z + m[9];
+  }
+};
+
+struct Collapse {
+  double cost;
+  unsigned int from;
+  unsigned int to;
+};
+
+static glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b,
+                                const glm::vec3& c) {
+  return glm::cross(b - a, c - a);
+}
+
+/* Whether moving `from` onto `to` flips or degenerates a triangle that
+   survives the collapse */
+static bool collapseFlips(const std::vector<Vertex>& vertices,
+                          const std::vector<unsigned int>& indices,
+                          const std::vector<unsigned int>& offsets,
+                          const std::vector<unsigned int>& adjacency,
+                          unsigned int from, unsigned int to) {
+  const glm::vec3& target = vertices[to].position;
+  for (unsigned int i = offsets[from]; i < offsets[from + 1]; i++) {
+    const unsigned int* triangle = &indices[adjacency[i] * 3];
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+      /* Collapses to a degenerate triangle and is removed */
+      continue;
+    }
+    glm::vec3 corners[3];
+    glm::vec3 moved[3];
+    for (int k = 0; k < 3; k++) {
+      corners[k] = vertices[triangle[k]].position;
+      moved[k] = triangle[k] == from ? target : corners[k];
+    }
+    glm::vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+    glm::vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+    if (glm::dot(before, after) <= 0.0F) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<unsigned int> simplifyMesh(const std::vector<Vertex>& vertices,
+                                       const std::vector<unsigned int>& indices,
+                                       size_t targetIndicesCount,
+                                       float maxError, float& error) {
+  std::vector<unsigned int> result = indices;
+  error = 0.0F;
+  size_t verticesCount = vertices.size();
+
+  std::vector<Quadric> quadrics(verticesCount);
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    glm::vec3 a = vertices[indices[t]].position;
+    glm::vec3 normal = triangleNormal(a, vertices[indices[t + 1]].position,
+                                      vertices[indices[t + 2]].position);
+    float length = glm::length(normal);
+    if (length == 0.0F) {
+      continue;
+    }
+    normal = normal / length;
+    double d = -glm::dot(normal, a);
+    for (int k = 0; k < 3; k++) {
+      quadrics[indices[t + k]].addPlane(normal.x, normal.y, normal.z, d);
+    }
+  }
+
+  /* Edges used by one triangle only are boundaries, or attribute seams
+     since the two sides of a seam use different vertices */
+  std::unordered_map<uint64_t, int> edgeUses;
+  auto edgeKey = [](unsigned int a, unsigned int b) {
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+  };
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    for (int k = 0; k < 3; k++) {
+      edgeUses[edgeKey(indices[t + k], indices[t + (k + 1) % 3])]++;
+    }
+  }
+  std::vector<bool> locked(verticesCount, false);
+  for (const auto& [key, uses] : edgeUses) {
+    if (uses == 1) {
+      locked[key >> 32] = true;
+      locked[key & 0xffffffffU] = true;
+    }
+  }
+
+  std::vector<unsigned int> offsets(verticesCount + 1);
+  std::vector<unsigned int> adjacency;
+  std::vector<Collapse> candidates;
+  std::vector<bool> touched(verticesCount);
+  std::vector<unsigned int> remap(verticesCount);
+  double maxCost = static_cast<double>(maxError) * maxError;
+
+  while (result.size() > targetIndicesCount) {
+    size_t trianglesCount = result.size() / 3;
+
+    /* Vertex -> triangle adjacency of the current index buffer */
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (unsigned int index : result) {
+      offsets[index + 1]++;
+    }
+    for (size_t v = 0; v < verticesCount; v++) {
+      offsets[v + 1] += offsets[v];
+    }
+    adjacency.resize(result.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < result.size(); i++) {
+      adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    candidates.clear();
+    for (size_t t = 0; t < trianglesCount; t++) {
+      for (int k = 0; k < 3; k++) {
+        unsigned int a = result[t * 3 + k];
+        unsigned int b = result[t * 3 + (k + 1) % 3];
+        /* Every interior edge is seen once in each direction */
+        if (locked[a]) {
+          continue;
+        }
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        candidates.push_back({q.evaluate(vertices[b].position), a, b});
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Collapse& x, const Collapse& y) {
+                return std::tie(x.cost, x.from, x.to) <
+                       std::tie(y.cost, y.from, y.to);
+              });
+
+    /* Each collapse removes about two triangles; don't overshoot */
+    size_t collapseBudget = (result.size() - targetIndicesCount) / 6 + 1;
+    size_t collapses = 0;
+    std::fill(touched.begin(), touched.end(), false);
+    for (size_t v = 0; v < verticesCount; v++) {
+      remap[v] = static_cast<unsigned int>(v);
+    }
+
+    for (const Collapse& collapse : candidates) {
+      if (collapse.cost > maxCost || collapses >= collapseBudget) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to] ||
+          collapseFlips(vertices, result, offsets, adjacency, collapse.from,
+                        collapse.to)) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      error = std::max(error, static_cast<float>(std::sqrt(
+                                  std::max(collapse.cost, 0.0))));
+      collapses++;
+
+      /* Keep this pass' collapses independent of each other */
+      for (unsigned int i = offsets[collapse.from];
+           i < offsets[collapse.from + 1]; i++) {
+        for (int k = 0; k < 3; k++) {
+          touched[result[adjacency[i] * 3 + k]] = true;
+        }
+      }
+    }
+
+    if (collapses == 0) {
+      break;
+    }
+
+    size_t out = 0;
+    for (size_t t = 0; t < trianglesCount; t++) {
+      unsigned int a = remap[result[t * 3]];
+      unsigned int b = remap[result[t * 3 + 1]];
+      unsigned int c = remap[result[t * 3 + 2]];
+      if (a == b || b == c || a == c) {
+        continue;
+      }
+      result[out++] = a;
+      result[out++] = b;
+      result[out++] = c;
+    }
+    result.resize(out);
+  }
+
+  return result;
+}
+
+std::vector<MeshLod> buildLodChain(const std::vector<Vertex>& vertices,
+                                   std::vector<unsigned int>& indices,
+                                   size_t maxLevels) {
+  std::vector<MeshLod> lods;
+  lods.push_back({0, indices.size(), 0.0F});
+
+  glm::vec3 center;
+  float radius;
+  computeBoundingSphere(vertices, center, radius);
+  /* Allow each level to deviate by up to a tenth of the mesh size */
+  float maxError = radius * 0.1F;
+
+  std::vector<unsigned int> previous(indices);
+  float accumulatedError = 0.0F;
+  for (size_t level = 1; level <= maxLevels; level++) {
+    size_t target = previous.size() / 2 / 3 * 3;
+    float error = 0.0F;
+    std::vector<unsigned int> simplified =
+        simplifyMesh(vertices, previous, target, maxError, error);
+    if (simplified.empty() || simplified.size() * 10 > previous.size() * 9) {
+      break;
+    }
+
+    optimizeVertexCache(simplified, vertices.size());
+    /* Each level starts from the previous one, so errors add up */
+    accumulatedError += error;
+    lods.push_back({indices.size(), simplified.size(), accumulatedError});
+    indices.insert(indices.end(), simplified.begin(), simplified.end());
+    previous = std::move(simplified);
+  }
+  return lods;
+}
@@ -0,0 +1,28 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "src/mesh.h"
+#include "src/vertex.h"
+
+/* Quadric error metric simplification (Garland & Heckbert) restricted to
+   collapsing a vertex into a neighbour, so the result is a new index buffer
+   over the same vertices. Boundary and attribute seam vertices never move.
+   Stops at targetIndicesCount or when nothing can collapse within
+   maxError. error receives the largest geometric error introduced, as a
+   distance in mesh units. */
+std::vector<unsigned int> simplifyMesh(const std::vector<Vertex>& vertices,
+                                       const std::vector<unsigned int>& indices,
+                                       size_t targetIndicesCount,
+                                       float maxError, float& error);
+
+/* Appends up to maxLevels successively halved index buffers to indices and
+   returns the LOD table, LOD 0 being the original indices. Levels that
+   don't remove at least a tenth of the triangles end the chain. */
+std::vector<MeshLod> buildLodChain(const std::vector<Vertex>& vertices,
+                                   std::vector<unsigned int>& indices,
+                                   size_t maxLevels = 4);
+
+#endif /* MESH_SIMPLIFIER_H */
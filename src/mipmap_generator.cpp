@@ -0,0 +1,344 @@
+#include "src/mipmap_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <numbers>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "src/thread_pool.h"
+
+static constexpr int KAISER_TAPS = 8;
+static constexpr float KAISER_BETA = 4.0f;
+/* Levels smaller than this are not worth waking the pool for */
+static constexpr size_t PARALLEL_TEXELS = 1 << 16;
+static constexpr int SRGB_ENCODE_STEPS = 16384;
+
+/* Always RGBA, unused channels are carried along as zeros */
+struct FloatImage {
+  int width;
+  int height;
+  std::vector<float> texels;
+};
+
+static float srgbToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f
+                           : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value) {
+  return value <= 0.0031308f ? value * 12.92f
+                             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static const float* srgbDecodeTable() {
+  static const std::array<float, 256> table = []() {
+    std::array<float, 256> values;
+    for (int i = 0; i < 256; i++) {
+      values[i] = srgbToLinear(i / 255.0f);
+    }
+    return values;
+  }();
+  return table.data();
+}
+
+/* Fine enough that the dark end, where sRGB is steepest, still rounds to
+   the right code */
+static const unsigned char* srgbEncodeTable() {
+  static const std::vector<unsigned char> table = []() {
+    std::vector<unsigned char> values(SRGB_ENCODE_STEPS + 1);
+    for (int i = 0; i <= SRGB_ENCODE_STEPS; i++) {
+      float encoded = linearToSrgb(static_cast<float>(i) / SRGB_ENCODE_STEPS);
+      values[i] = static_cast<unsigned char>(std::lround(encoded * 255.0f));
+    }
+    return values;
+  }();
+  return table.data();
+}
+
+static float besselI0(float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (int k = 1; k < 20; k++) {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/* Taps for halving: source texels 2x-3 .. 2x+4 around the destination
+   center at 2x+0.5, a sinc at half the source rate windowed by Kaiser */
+static const float* kaiserWeights() {
+  static const std::array<float, KAISER_TAPS> weights = []() {
+    std::array<float, KAISER_TAPS> values;
+    float radius = KAISER_TAPS / 2.0f;
+    float total = 0.0f;
+    for (int t = 0; t < KAISER_TAPS; t++) {
+      float distance = t - (KAISER_TAPS - 1) / 2.0f;
+      float u = std::numbers::pi_v<float> * distance / 2.0f;
+      float sinc = std::sin(u) / u;
+      float r = distance / radius;
+      float window = besselI0(KAISER_BETA * std::sqrt(1.0f - r * r)) /
+                     besselI0(KAISER_BETA);
+      values[t] = sinc * window;
+      total += values[t];
+    }
+    for (float& value : values) {
+      value /= total;
+    }
+    return values;
+  }();
+  return weights.data();
+}
+
+/* Calls func(begin, end) over row ranges, on the pool when the work is big
+   enough to pay for it */
+static void forRows(int rows, int rowTexels, bool parallel,
+                    const std::function<void(int, int)>& func) {
+  ThreadPool& pool = ThreadPool::global();
+  size_t texels = static_cast<size_t>(rows) * rowTexels;
+  if (!parallel || texels < PARALLEL_TEXELS || pool.size() == 0 || rows < 2) {
+    func(0, rows);
+    return;
+  }
+
+  size_t chunks = std::min<size_t>(rows, (pool.size() + 1) * 4);
+  pool.parallelFor(chunks, [&](size_t chunk) {
+    int begin = static_cast<int>(rows * chunk / chunks);
+    int end = static_cast<int>(rows * (chunk + 1) / chunks);
+    func(begin, end);
+  });
+}
+
+static FloatImage toLinear(const unsigned char* pixels, int width, int height,
+                           int channels, const MipChainOptions& options) {
+  FloatImage image{width, height,
+                   std::vector<float>(static_cast<size_t>(width) * height * 4)};
+  bool srgb = options.srgb && channels >= 3;
+  const float* decode = srgbDecodeTable();
+
+  forRows(height, width, options.parallel, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      for (int x = 0; x < width; x++) {
+        size_t texel = static_cast<size_t>(y) * width + x;
+        const unsigned char* source = pixels + texel * channels;
+        float* target = &image.texels[texel * 4];
+        for (int c = 0; c < 4; c++) {
+          if (c >= channels) {
+            target[c] = 0.0f;
+          } else if (srgb && c < 3) {
+            target[c] = decode[source[c]];
+          } else {
+            target[c] = source[c] / 255.0f;
+          }
+        }
+      }
+    }
+  });
+  return image;
+}
+
+static void fromLinear(const FloatImage& image, int channels,
+                       const MipChainOptions& options, unsigned char* pixels) {
+  bool srgb = options.srgb && channels >= 3;
+  const unsigned char* encode = srgbEncodeTable();
+
+  forRows(image.height, image.width, options.parallel, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      for (int x = 0; x < image.width; x++) {
+        size_t texel = static_cast<size_t>(y) * image.width + x;
+        const float* source = &image.texels[texel * 4];
+        unsigned char* target = pixels + texel * channels;
+        for (int c = 0; c < channels; c++) {
+          float value = std::clamp(source[c], 0.0f, 1.0f);
+          if (srgb && c < 3) {
+            target[c] = encode[static_cast<int>(value * SRGB_ENCODE_STEPS +
+                                                0.5f)];
+          } else {
+            target[c] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+          }
+        }
+      }
+    }
+  });
+}
+
+static void boxRow(const float* row0, const float* row1, int sourceWidth,
+                   float* out, int width) {
+  int x = 0;
+#if defined(__AVX__)
+  /* Two destination texels from four source texels of both rows */
+  const __m256 quarter8 = _mm256_set1_ps(0.25f);
+  for (; x + 1 < width && 2 * x + 3 < sourceWidth; x += 2) {
+    const float* a = row0 + 8 * x;
+    const float* b = row1 + 8 * x;
+    __m256 first = _mm256_add_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+    __m256 second =
+        _mm256_add_ps(_mm256_loadu_ps(a + 8), _mm256_loadu_ps(b + 8));
+    __m256 even = _mm256_permute2f128_ps(first, second, 0x20);
+    __m256 odd = _mm256_permute2f128_ps(first, second, 0x31);
+    _mm256_storeu_ps(out + 4 * x,
+                     _mm256_mul_ps(_mm256_add_ps(even, odd), quarter8));
+  }
+#endif
+  for (; x < width; x++) {
+    int x0 = std::min(2 * x, sourceWidth - 1);
+    int x1 = std::min(2 * x + 1, sourceWidth - 1);
+#if defined(__SSE2__)
+    __m128 sum = _mm_add_ps(
+        _mm_add_ps(_mm_loadu_ps(row0 + 4 * x0), _mm_loadu_ps(row0 + 4 * x1)),
+        _mm_add_ps(_mm_loadu_ps(row1 + 4 * x0), _mm_loadu_ps(row1 + 4 * x1)));
+    _mm_storeu_ps(out + 4 * x, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+    for (int c = 0; c < 4; c++) {
+      out[4 * x + c] = 0.25f * (row0[4 * x0 + c] + row0[4 * x1 + c] +
+                                row1[4 * x0 + c] + row1[4 * x1 + c]);
+    }
+#endif
+  }
+}
+
+static FloatImage downsampleBox(const FloatImage& source, bool parallel) {
+  FloatImage result{std::max(1, source.width / 2),
+                    std::max(1, source.height / 2), {}};
+  result.texels.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+  forRows(result.height, result.width, parallel, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      int y0 = std::min(2 * y, source.height - 1);
+      int y1 = std::min(2 * y + 1, source.height - 1);
+      boxRow(&source.texels[static_cast<size_t>(y0) * source.width * 4],
+             &source.texels[static_cast<size_t>(y1) * source.width * 4],
+             source.width,
+             &result.texels[static_cast<size_t>(y) * result.width * 4],
+             result.width);
+    }
+  });
+  return result;
+}
+
+static FloatImage kaiserHorizontal(const FloatImage& source, bool parallel) {
+  if (source.width == 1) {
+    return source;
+  }
+  const float* weights = kaiserWeights();
+  FloatImage result{source.width / 2, source.height, {}};
+  result.texels.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+  forRows(result.height, result.width, parallel, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      const float* row =
+          &source.texels[static_cast<size_t>(y) * source.width * 4];
+      float* out = &result.texels[static_cast<size_t>(y) * result.width * 4];
+      for (int x = 0; x < result.width; x++) {
+        int first = 2 * x - (KAISER_TAPS / 2 - 1);
+#if defined(__SSE2__)
+        __m128 sum = _mm_setzero_ps();
+        for (int t = 0; t < KAISER_TAPS; t++) {
+          int sourceX = std::clamp(first + t, 0, source.width - 1);
+          sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]),
+                                           _mm_loadu_ps(row + 4 * sourceX)));
+        }
+        _mm_storeu_ps(out + 4 * x, sum);
+#else
+        float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int t = 0; t < KAISER_TAPS; t++) {
+          int sourceX = std::clamp(first + t, 0, source.width - 1);
+          for (int c = 0; c < 4; c++) {
+            sum[c] += weights[t] * row[4 * sourceX + c];
+          }
+        }
+        std::memcpy(out + 4 * x, sum, sizeof(sum));
+#endif
+      }
+    }
+  });
+  return result;
+}
+
+static FloatImage kaiserVertical(const FloatImage& source, bool parallel) {
+  if (source.height == 1) {
+    return source;
+  }
+  const float* weights = kaiserWeights();
+  FloatImage result{source.width, source.height / 2, {}};
+  result.texels.resize(static_cast<size_t>(result.width) * result.height * 4);
+  int rowFloats = source.width * 4;
+
+  forRows(result.height, result.width, parallel, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      const float* rows[KAISER_TAPS];
+      int first = 2 * y - (KAISER_TAPS / 2 - 1);
+      for (int t = 0; t < KAISER_TAPS; t++) {
+        int sourceY = std::clamp(first + t, 0, source.height - 1);
+        rows[t] = &source.texels[static_cast<size_t>(sourceY) * rowFloats];
+      }
+      float* out = &result.texels[static_cast<size_t>(y) * rowFloats];
+
+      /* Whole rows are weighted at once, so this vectorizes across texels */
+      int i = 0;
+#if defined(__AVX__)
+      for (; i + 8 <= rowFloats; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (int t = 0; t < KAISER_TAPS; t++) {
+          sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[t]),
+                                                 _mm256_loadu_ps(rows[t] + i)));
+        }
+        _mm256_storeu_ps(out + i, sum);
+      }
+#endif
+#if defined(__SSE2__)
+      for (; i + 4 <= rowFloats; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (int t = 0; t < KAISER_TAPS; t++) {
+          sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]),
+                                           _mm_loadu_ps(rows[t] + i)));
+        }
+        _mm_storeu_ps(out + i, sum);
+      }
+#endif
+      for (; i < rowFloats; i++) {
+        float sum = 0.0f;
+        for (int t = 0; t < KAISER_TAPS; t++) {
+          sum += weights[t] * rows[t][i];
+        }
+        out[i] = sum;
+      }
+    }
+  });
+  return result;
+}
+
+MipChain generateMipChain(const unsigned char* pixels, int width, int height,
+                          int channels, const MipChainOptions& options) {
+  MipChain chain;
+  chain.channels = channels;
+
+  /* The source is level 0 as is, re-encoding it could only lose precision */
+  size_t baseSize = static_cast<size_t>(width) * height * channels;
+  chain.data.reserve(baseSize + baseSize / 3 + 64);
+  chain.data.assign(pixels, pixels + baseSize);
+  chain.levels.push_back({width, height, 0, baseSize});
+
+  FloatImage level = toLinear(pixels, width, height, channels, options);
+  while (level.width > 1 || level.height > 1) {
+    if (options.filter == MipFilter::KAISER) {
+      level = kaiserVertical(kaiserHorizontal(level, options.parallel),
+                             options.parallel);
+    } else {
+      level = downsampleBox(level, options.parallel);
+    }
+
+    size_t offset = chain.data.size();
+    size_t size = static_cast<size_t>(level.width) * level.height * channels;
+    chain.data.resize(offset + size);
+    fromLinear(level, channels, options, chain.data.data() + offset);
+    chain.levels.push_back({level.width, level.height, offset, size});
+  }
+  return chain;
+}
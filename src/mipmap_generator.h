@@ -0,0 +1,45 @@
+#ifndef MIPMAP_GENERATOR_H
+#define MIPMAP_GENERATOR_H
+
+#include <cstddef>
+#include <vector>
+
+enum class MipFilter {
+  /* 2x2 average, what glGenerateMipmap does on most drivers */
+  BOX,
+  /* 8-tap Kaiser-windowed sinc, sharper with less aliasing */
+  KAISER,
+};
+
+struct MipChainOptions {
+  MipFilter filter = MipFilter::BOX;
+  /* Color channels of 3 and 4 channel images are sRGB-encoded; they are
+     filtered in linear light and re-encoded. Alpha is always linear. */
+  bool srgb = true;
+  /* Splits large levels across ThreadPool::global(). Must be false when
+     called from a pool worker, which would otherwise wait on itself. */
+  bool parallel = true;
+};
+
+struct MipLevel {
+  int width;
+  int height;
+  /* Byte range of the level inside MipChain::data */
+  size_t offset;
+  size_t size;
+};
+
+/* Tightly packed 8-bit levels, level 0 (the source) first, down to 1x1 */
+struct MipChain {
+  int channels;
+  std::vector<MipLevel> levels;
+  std::vector<unsigned char> data;
+};
+
+/* Builds the full mip chain of an 8-bit image with 1-4 channels. Levels are
+   filtered from the previous level kept in float, so rounding doesn't
+   accumulate. Uses AVX or SSE when the build targets them. */
+MipChain generateMipChain(const unsigned char* pixels, int width, int height,
+                          int channels, const MipChainOptions& options = {});
+
+#endif /* MIPMAP_GENERATOR_H */
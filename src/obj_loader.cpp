@@ -0,0 +1,188 @@
+#include "src/obj_loader.h"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+#include "src/exceptions.h"
+#include "src/logger.h"
+
+struct ObjCorner {
+  int position;
+  int texCoords;
+  int normal;
+
+  bool operator==(const ObjCorner& other) const {
+    return position == other.position && texCoords == other.texCoords &&
+           normal == other.normal;
+  }
+};
+
+struct ObjCornerHash {
+  size_t operator()(const ObjCorner& corner) const {
+    size_t hash = std::hash<int>()(corner.position);
+    hash = hash * 31 + std::hash<int>()(corner.texCoords);
+    hash = hash * 31 + std::hash<int>()(corner.normal);
+    return hash;
+  }
+};
+
+static std::string_view nextToken(std::string_view& line) {
+  size_t start = line.find_first_not_of(" \t\r");
+  if (start == std::string_view::npos) {
+    line = {};
+    return {};
+  }
+  size_t end = line.find_first_of(" \t\r", start);
+  if (end == std::string_view::npos) {
+    end = line.size();
+  }
+  std::string_view token = line.substr(start, end - start);
+  line.remove_prefix(end);
+  return token;
+}
+
+static float parseFloat(std::string_view token, size_t lineNumber) {
+  float value = 0.0F;
+  auto [end, error] =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  if (error != std::errc()) {
+    throw ResourceException("Invalid number '" + std::string(token) +
+                            "' on line " + std::to_string(lineNumber));
+  }
+  return value;
+}
+
+/* OBJ indices are 1-based, negative ones count back from the end. Returns a
+   0-based index or -1 for an empty field */
+static int parseIndex(std::string_view field, size_t count,
+                      size_t lineNumber) {
+  if (field.empty()) {
+    return -1;
+  }
+  int value = 0;
+  auto [end, error] =
+      std::from_chars(field.data(), field.data() + field.size(), value);
+  int resolved = value < 0 ? static_cast<int>(count) + value : value - 1;
+  if (error != std::errc() || value == 0 || resolved < 0 ||
+      resolved >= static_cast<int>(count)) {
+    throw ResourceException("Invalid face index '" + std::string(field) +
+                            "' on line " + std::to_string(lineNumber));
+  }
+  return resolved;
+}
+
+MeshData loadObj(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  if (!file) {
+    LOG_ERROR("Cannot open model under ", path, ": ", strerror(errno));
+    throw FileNotFoundException("Cannot open model " + path.string());
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texCoords;
+
+  MeshData mesh;
+  std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> cornerIndices;
+  std::vector<ObjCorner> face;
+
+  std::string lineBuffer;
+  size_t lineNumber = 0;
+  while (std::getline(file, lineBuffer)) {
+    lineNumber++;
+    std::string_view line = lineBuffer;
+    std::string_view keyword = nextToken(line);
+
+    if (keyword == "v") {
+      glm::vec3 position;
+      for (int i = 0; i < 3; i++) {
+        position[i] = parseFloat(nextToken(line), lineNumber);
+      }
+      positions.push_back(position);
+    } else if (keyword == "vn") {
+      glm::vec3 normal;
+      for (int i = 0; i < 3; i++) {
+        normal[i] = parseFloat(nextToken(line), lineNumber);
+      }
+      normals.push_back(normal);
+    } else if (keyword == "vt") {
+      glm::vec2 uv;
+      for (int i = 0; i < 2; i++) {
+        uv[i] = parseFloat(nextToken(line), lineNumber);
+      }
+      texCoords.push_back(uv);
+    } else if (keyword == "f") {
+      face.clear();
+      for (std::string_view token = nextToken(line); !token.empty();
+           token = nextToken(line)) {
+        /* v, v/vt, v//vn or v/vt/vn */
+        size_t firstSlash = token.find('/');
+        size_t secondSlash = firstSlash == std::string_view::npos
+                                 ? std::string_view::npos
+                                 : token.find('/', firstSlash + 1);
+        ObjCorner corner;
+        corner.position = parseIndex(token.substr(0, firstSlash),
+                                     positions.size(), lineNumber);
+        corner.texCoords = -1;
+        corner.normal = -1;
+        if (firstSlash != std::string_view::npos) {
+          corner.texCoords = parseIndex(
+              token.substr(firstSlash + 1, secondSlash - firstSlash - 1),
+              texCoords.size(), lineNumber);
+        }
+        if (secondSlash != std::string_view::npos) {
+          corner.normal = parseIndex(token.substr(secondSlash + 1),
+                                     normals.size(), lineNumber);
+        }
+        if (corner.position < 0) {
+          throw ResourceException("Face without position on line " +
+                                  std::to_string(lineNumber));
+        }
+        face.push_back(corner);
+      }
+
+      for (size_t i = 1; i + 1 < face.size(); i++) {
+        ObjCorner triangle[3] = {face[0], face[i], face[i + 1]};
+        glm::vec3 flatNormal =
+            glm::cross(positions[triangle[1].position] -
+                           positions[triangle[0].position],
+                       positions[triangle[2].position] -
+                           positions[triangle[0].position]);
+        float area = glm::length(flatNormal);
+        flatNormal =
+            area > 0.0F ? flatNormal / area : glm::vec3(0.0F, 1.0F, 0.0F);
+
+        for (const ObjCorner& corner : triangle) {
+          /* Corners without a normal depend on the face, don't share them */
+          auto it = corner.normal < 0 ? cornerIndices.end()
+                                      : cornerIndices.find(corner);
+          if (it != cornerIndices.end()) {
+            mesh.indices.push_back(it->second);
+            continue;
+          }
+
+          Vertex vertex;
+          vertex.position = positions[corner.position];
+          vertex.normal =
+              corner.normal < 0 ? flatNormal : normals[corner.normal];
+          vertex.texCoords = corner.texCoords < 0 ? glm::vec2(0.0F)
+                                                  : texCoords[corner.texCoords];
+          unsigned int index = static_cast<unsigned int>(mesh.vertices.size());
+          mesh.vertices.push_back(vertex);
+          mesh.indices.push_back(index);
+          if (corner.normal >= 0) {
+            cornerIndices.emplace(corner, index);
+          }
+        }
+      }
+    }
+    /* Everything else (o, g, s, usemtl, mtllib, comments) is ignored */
+  }
+
+  LOG_INFO("Parsed ", path, ": ", mesh.vertices.size(), " vertices, ",
+           mesh.indices.size() / 3, " triangles");
+  return mesh;
+}
@@ -0,0 +1,19 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <filesystem>
+#include <vector>
+
+#include "src/vertex.h"
+
+struct MeshData {
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+};
+
+/* Loads every face of a Wavefront OBJ file into a single mesh. Polygons are
+   triangulated as fans, faces without normals get flat normals, and
+   materials, groups and smoothing groups are ignored */
+MeshData loadObj(const std::filesystem::path& path);
+
+#endif /* OBJ_LOADER_H */
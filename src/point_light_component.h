@@ -6,7 +6,7 @@
 #include "src/game_object.h"
 #include "src/light_component.h"
 
-class PointLightComponent : public LightComponent {
+class PointLightComponent final : public LightComponent {
  private:
   glm::vec3 direction;
 
@@ -22,7 +22,7 @@ class PointLightComponent : public LightComponent {
                       glm::vec3 ambient = glm::vec3(0.1f),
                       glm::vec3 diffuse = glm::vec3(0.8f),
                       glm::vec3 specular = glm::vec3(1.0f))
-      : LightComponent(ambient, diffuse, specular),
+      : LightComponent(LightType::POINT, ambient, diffuse, specular),
         constant(constant),
         linear(linear),
         quadratic(quadratic) {}
@@ -37,6 +37,11 @@ class PointLightComponent : public LightComponent {
     quadratic = q;
   }
 
+  /* Radius beyond which the light's contribution is negligible */
+  float getRange() const {
+    return attenuationRange(constant, linear, quadratic);
+  }
+
   std::string getTypeName() const override { return "PointLightComponent"; }
 
   void setUniforms(Shader* shader, int idx) override {
@@ -0,0 +1,185 @@
+#include "src/program_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "src/logger.h"
+
+static constexpr char PROGRAM_CACHE_MAGIC[4] = {'P', 'R', 'G', 'B'};
+
+struct ProgramCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t binaryFormat;
+  uint32_t binarySize;
+};
+
+static_assert(std::is_trivially_copyable_v<ProgramCacheHeader>);
+
+static constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+/* FNV-1a, the string's terminator is hashed too so "ab" + "c" and
+   "a" + "bc" differ */
+static uint64_t hashString(uint64_t hash, const char* string) {
+  if (string) {
+    for (const char* c = string; *c; c++) {
+      hash = (hash ^ static_cast<unsigned char>(*c)) * FNV_PRIME;
+    }
+  }
+  return hash * FNV_PRIME;
+}
+
+ProgramCache::ProgramCache(std::filesystem::path directory)
+    : directory(std::move(directory)),
+      driverHash(0),
+      supported(false),
+      initialized(false) {}
+
+void ProgramCache::initGL() {
+  initialized = true;
+
+  GLint formats = 0;
+  if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  }
+  supported = formats > 0;
+  if (!supported) {
+    LOG_INFO("Program binaries unsupported, shaders compile every run");
+    return;
+  }
+
+  uint64_t hash = FNV_OFFSET;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION,
+                      GL_SHADING_LANGUAGE_VERSION}) {
+    hash = hashString(hash,
+                      reinterpret_cast<const char*>(glGetString(name)));
+  }
+  driverHash = hash;
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    LOG_WARNING("Cannot create shader cache ", directory, ": ",
+                error.message());
+    supported = false;
+  }
+}
+
+bool ProgramCache::isSupported() {
+  if (!initialized) {
+    initGL();
+  }
+  return supported;
+}
+
+uint64_t ProgramCache::keyFor(const std::string& vertexSource,
+                              const std::string& fragmentSource) {
+  isSupported();
+  uint64_t hash = hashString(driverHash, vertexSource.c_str());
+  return hashString(hash, fragmentSource.c_str());
+}
+
+std::filesystem::path ProgramCache::pathFor(uint64_t key) const {
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << key << EXTENSION;
+  return directory / name.str();
+}
+
+GLuint ProgramCache::load(uint64_t key) {
+  if (!isSupported()) {
+    return 0;
+  }
+
+  std::filesystem::path path = pathFor(key);
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return 0;
+  }
+  std::streamoff fileSize = file.tellg();
+  file.seekg(0);
+
+  ProgramCacheHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file ||
+      std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) ||
+      header.version != VERSION || header.key != key) {
+    LOG_WARNING("Ignoring invalid program binary ", path);
+    return 0;
+  }
+  /* Checked before allocating, a corrupt size could ask for anything */
+  if (header.binarySize == 0 ||
+      header.binarySize > static_cast<uint64_t>(fileSize) - sizeof(header)) {
+    LOG_WARNING("Truncated program binary ", path);
+    return 0;
+  }
+  std::vector<char> binary(header.binarySize);
+  file.read(binary.data(), binary.size());
+  if (!file) {
+    LOG_WARNING("Truncated program binary ", path);
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, header.binaryFormat, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint success = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    /* Drivers may reject their own binaries, e.g. after a GPU swap with
+       identical strings. Rebuilding overwrites the file anyway. */
+    LOG_INFO("Driver rejected program binary ", path, ", recompiling");
+    glDeleteProgram(program);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return 0;
+  }
+  return program;
+}
+
+void ProgramCache::store(uint64_t key, GLuint program) {
+  if (!isSupported()) {
+    return;
+  }
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  ProgramCacheHeader header = {};
+  std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+  header.version = VERSION;
+  header.key = key;
+  header.binaryFormat = format;
+  header.binarySize = static_cast<uint32_t>(length);
+
+  /* Written aside and renamed, so a crash never leaves a torn binary */
+  std::filesystem::path path = pathFor(key);
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (!file) {
+      LOG_WARNING("Failed writing program binary ", tempPath);
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    LOG_WARNING("Failed saving program binary ", path, ": ", error.message());
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include <GL/glew.h>
+
+/* Stores linked programs as driver binaries (glGetProgramBinary), one file
+   per program named after its key:
+
+     ProgramCacheHeader | binary
+
+   The key hashes the include-expanded sources together with the driver's
+   vendor, renderer and version strings, so a driver update or an edited
+   include misses instead of loading a stale binary. Any failure falls back
+   to compiling; the cache is only an accelerator. */
+class ProgramCache {
+ private:
+  std::filesystem::path directory;
+  /* Hash of the driver strings, mixed into every key */
+  uint64_t driverHash;
+  bool supported;
+  bool initialized;
+
+  void initGL();
+  std::filesystem::path pathFor(uint64_t key) const;
+
+ public:
+  static constexpr uint32_t VERSION = 1;
+  static constexpr const char* DEFAULT_DIRECTORY = "shader_cache";
+  static constexpr const char* EXTENSION = ".glprog";
+
+  explicit ProgramCache(std::filesystem::path directory = DEFAULT_DIRECTORY);
+
+  /* False when the driver offers no binary formats; load() then always
+     misses and store() does nothing */
+  bool isSupported();
+
+  uint64_t keyFor(const std::string& vertexSource,
+                  const std::string& fragmentSource);
+
+  /* Returns a linked program, or 0 when there is no usable binary. Stale
+     files the driver rejects are deleted. */
+  GLuint load(uint64_t key);
+
+  /* Saves a linked program. Programs should be linked with
+     GL_PROGRAM_BINARY_RETRIEVABLE_HINT set, some drivers return nothing
+     otherwise. */
+  void store(uint64_t key, GLuint program);
+};
+
+#endif /* PROGRAM_CACHE_H */
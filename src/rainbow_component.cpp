@@ -22,5 +22,6 @@ void RainbowComponent::update(float deltaTime) {
   glm::vec3 hsvColor(hue, 1.0f, 1.0f);
   glm::vec3 rgbColor = glm::rgbColor(hsvColor);
 
-  gameObject->getMaterial()->setBaseColor(rgbColor);
+  /* Only this object changes; its material may be shared */
+  gameObject->setColor(rgbColor);
 }
@@ -5,7 +5,7 @@
 
 #include "src/component.h"
 
-class RainbowComponent : public Component {
+class RainbowComponent final : public Component {
  private:
   float hue;
   float speed;
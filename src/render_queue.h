@@ -0,0 +1,19 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+class GameObject;
+class Material;
+
+/* Objects to draw, grouped by (priority, material). Priority 0 holds opaque
+   materials and is drawn first, 1 holds transparent ones. */
+using RenderQueue =
+    std::map<std::pair<int, Material*>, std::vector<GameObject*>>;
+
+constexpr int OPAQUE_PRIORITY = 0;
+constexpr int TRANSPARENT_PRIORITY = 1;
+
+#endif /* RENDER_QUEUE_H */
@@ -1,7 +1,30 @@
 #include "src/resource_manager.h"
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <thread>
+
 #include "src/exceptions.h"
 #include "src/logger.h"
+#include "src/mesh_cache.h"
+#include "src/mesh_cooker.h"
+#include "src/mesh_simplifier.h"
+
+/* How long loadShaders sleeps when no program has finished compiling */
+static constexpr std::chrono::microseconds SHADER_POLL_INTERVAL(200);
+
+template <typename Container>
+static void requireNewName(const std::string& resourceType,
+                           const Container& container,
+                           const std::string& name) {
+  if (container.count(name)) {
+    std::string message = resourceType + " '" + name + "' already exists";
+    LOG_ERROR(message);
+    throw ResourceException("Failed to load " + resourceType + " '" + name +
+                            "': " + message);
+  }
+}
 
 template <typename T, typename... Args>
 std::shared_ptr<T> ResourceManager::loadResource(
@@ -11,12 +34,7 @@ std::shared_ptr<T> ResourceManager::loadResource(
 
   LOG_INFO("Loading ", resourceType, ": ", name);
 
-  if (container.count(name)) {
-    std::string message = resourceType + " '" + name + "' already exists";
-    LOG_ERROR(message);
-    throw ResourceException("Failed to load " + resourceType + " '" + name +
-                            "': " + message);
-  }
+  requireNewName(resourceType, container, name);
 
   try {
     std::shared_ptr<T> resource =
@@ -44,22 +62,283 @@ std::shared_ptr<T> ResourceManager::getResource(
   return container.at(name);
 }
 
+ResourceManager::ResourceManager()
+    : meshOptimization(true),
+      programCaching(false),
+      shaderHotReload(false),
+      texturePacking(false),
+      texturesToPack(false),
+      textureStreaming(false) {}
+
 std::shared_ptr<Shader> ResourceManager::loadShader(
     const std::string& name, const std::filesystem::path& vertexPath,
     const std::filesystem::path& fragmentPath) {
-  return loadResource<Shader>("shader", shaders, name, vertexPath,
-                              fragmentPath);
+  std::shared_ptr<Shader> shader =
+      loadResource<Shader>("shader", shaders, name, vertexPath, fragmentPath,
+                           shaderOptions({}, true));
+  watchShader(*shader);
+  return shader;
+}
+
+ShaderOptions ResourceManager::shaderOptions(const ShaderDefines& defines,
+                                             bool wait) {
+  ShaderOptions options;
+  options.cache = programCaching ? &programCache : nullptr;
+  options.preprocessor = &shaderPreprocessor;
+  options.defines = defines;
+  options.wait = wait;
+  return options;
+}
+
+std::vector<std::shared_ptr<Shader>> ResourceManager::loadShaders(
+    const std::vector<ShaderSource>& sources) {
+  if (GLEW_KHR_parallel_shader_compile) {
+    /* Let the driver pick as many compiler threads as it likes */
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  }
+
+  /* A source that fails to even issue must not strand the ones before
+     it registered but never finished, so keep going and throw at the
+     end like for failures found while finishing */
+  std::exception_ptr failure;
+  std::vector<std::shared_ptr<Shader>> loaded;
+  loaded.reserve(sources.size());
+  for (const ShaderSource& source : sources) {
+    try {
+      loaded.push_back(loadResource<Shader>(
+          "shader", shaders, source.name, source.vertexPath,
+          source.fragmentPath, shaderOptions(source.defines, false)));
+    } catch (const std::exception&) {
+      if (!failure) {
+        failure = std::current_exception();
+      }
+    }
+  }
+
+  std::vector<Shader*> pending;
+  for (const std::shared_ptr<Shader>& shader : loaded) {
+    pending.push_back(shader.get());
+  }
+  while (!pending.empty()) {
+    size_t finished = std::erase_if(pending, [&](Shader* shader) {
+      if (!shader->isReady()) {
+        return false;
+      }
+      try {
+        shader->finish();
+      } catch (const std::exception& e) {
+        LOG_ERROR("Failed to load shader '", shader->getName(), "': ",
+                  e.what());
+        shaders.erase(shader->getName());
+        if (!failure) {
+          failure = std::current_exception();
+        }
+      }
+      return true;
+    });
+    if (finished == 0) {
+      std::this_thread::sleep_for(SHADER_POLL_INTERVAL);
+    }
+  }
+  /* Programs that did load stay registered either way */
+  for (const std::shared_ptr<Shader>& shader : loaded) {
+    if (shaders.count(shader->getName())) {
+      watchShader(*shader);
+    }
+  }
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return loaded;
+}
+
+void ResourceManager::watchShader(const Shader& shader) {
+  if (!shaderHotReload) {
+    return;
+  }
+  for (const std::filesystem::path& file : shader.getSourceFiles()) {
+    shaderWatcher.watch(file);
+  }
+}
+
+void ResourceManager::setShaderHotReloadEnabled(bool enabled) {
+  shaderHotReload = enabled;
+  for (const auto& [name, shader] : shaders) {
+    watchShader(*shader);
+  }
+  for (const auto& [key, shader] : shaderPermutations) {
+    watchShader(*shader);
+  }
+}
+
+void ResourceManager::reloadShaderIfChanged(
+    const std::shared_ptr<Shader>& shader,
+    const std::vector<std::filesystem::path>& files) {
+  std::vector<std::filesystem::path> sources = shader->getSourceFiles();
+  bool affected = std::any_of(files.begin(), files.end(),
+                              [&](const std::filesystem::path& file) {
+                                return std::find(sources.begin(), sources.end(),
+                                                 file) != sources.end();
+                              });
+  if (!affected) {
+    return;
+  }
+
+  LOG_INFO("Recompiling shader '", shader->getName(), "'");
+  std::unique_ptr<Shader> rebuilt;
+  try {
+    rebuilt = std::make_unique<Shader>(
+        shader->getVertexPath(), shader->getFragmentPath(),
+        shaderOptions(shader->getDefines(), false));
+  } catch (const std::exception& e) {
+    LOG_ERROR("Reloading shader '", shader->getName(), "' failed: ",
+              e.what());
+    return;
+  }
+  /* A newer edit supersedes a rebuild still in flight */
+  std::erase_if(shaderReloads, [&](const auto& reload) {
+    return reload.first == shader;
+  });
+  shaderReloads.emplace_back(shader, std::move(rebuilt));
+}
+
+void ResourceManager::processShaderReloads() {
+  if (!shaderHotReload) {
+    return;
+  }
+
+  std::vector<std::filesystem::path> changed = shaderWatcher.poll();
+  if (!changed.empty()) {
+    for (const std::filesystem::path& file : changed) {
+      LOG_INFO("Shader source changed: ", file);
+      shaderPreprocessor.invalidate(file);
+    }
+    for (const auto& [name, shader] : shaders) {
+      reloadShaderIfChanged(shader, changed);
+    }
+    for (const auto& [key, shader] : shaderPermutations) {
+      reloadShaderIfChanged(shader, changed);
+    }
+  }
+
+  std::erase_if(shaderReloads, [&](auto& reload) {
+    auto& [shader, rebuilt] = reload;
+    if (!rebuilt->isReady()) {
+      return false;
+    }
+    try {
+      rebuilt->finish();
+    } catch (const std::exception& e) {
+      LOG_ERROR("Reloading shader '", shader->getName(),
+                "' failed, keeping the previous program: ", e.what());
+      return true;
+    }
+    shader->swapProgram(*rebuilt);
+    /* The edit may have added includes */
+    watchShader(*shader);
+    LOG_INFO("Reloaded shader '", shader->getName(), "'");
+    return true;
+  });
 }
 
 std::shared_ptr<Mesh> ResourceManager::loadMesh(
-    const std::string& name, const std::vector<Vertex>& vertices,
-    const std::vector<unsigned int>& indices) {
-  return loadResource<Mesh>("mesh", meshes, name, vertices, indices);
+    const std::string& name, std::vector<Vertex> vertices,
+    std::vector<unsigned int> indices, MeshResidency residency,
+    VertexFormat format) {
+  /* Before spending time on optimization and LODs */
+  requireNewName("mesh", meshes, name);
+  if (meshOptimization) {
+    optimizeAndReport(name, vertices, indices);
+  }
+  std::vector<MeshLod> lods = buildLodChain(vertices, indices);
+  return loadResource<Mesh>("mesh", meshes, name, std::move(vertices),
+                            std::move(indices), residency, format, meshPool,
+                            std::move(lods));
+}
+
+std::shared_ptr<Mesh> ResourceManager::loadModel(
+    const std::string& name, const std::filesystem::path& path,
+    VertexFormat format) {
+  /* Before parsing or mapping anything, like createMaterial */
+  requireNewName("mesh", meshes, name);
+  std::filesystem::path cachePath = MeshCache::pathFor(path);
+
+  MeshCacheKey key;
+  try {
+    key = MeshCache::keyFor(path, format);
+  } catch (const std::filesystem::filesystem_error& e) {
+    LOG_ERROR("Cannot stat model ", path, ": ", e.what());
+    throw FileNotFoundException("Cannot open model " + path.string());
+  }
+
+  if (std::unique_ptr<MeshCache> cache = MeshCache::open(cachePath, key)) {
+    LOG_INFO("Using mesh cache ", cachePath);
+    return loadResource<Mesh>("mesh", meshes, name, cache->getData(),
+                              meshPool);
+  }
+
+  CookedMesh cooked = cookModel(name, path, key);
+  return loadResource<Mesh>("mesh", meshes, name, cooked.data, meshPool);
 }
 
 std::shared_ptr<Texture2D> ResourceManager::loadTexture(
-    const std::string& name, const std::filesystem::path& path) {
-  return loadResource<Texture2D>("texture", textures, name, path);
+    const std::string& name, const std::filesystem::path& path, bool srgb) {
+  std::shared_ptr<Texture2D> texture =
+      loadResource<Texture2D>("texture", textures, name);
+  textureLoader.load(texture, path, srgb);
+  texturesToPack = true;
+  return texture;
+}
+
+void ResourceManager::processTextureUploads(float budgetMs) {
+  textureLoader.update(budgetMs);
+  if (texturePacking && texturesToPack &&
+      textureLoader.pendingCount() == 0) {
+    packTextures();
+    texturesToPack = false;
+  }
+
+  if (textureStreaming) {
+    streamedTextures.clear();
+    for (const auto& [name, texture] : textures) {
+      streamedTextures.push_back(texture.get());
+    }
+    textureStreamer.update(streamedTextures, texturePacker.getBytes());
+  }
+  Texture::advanceFrame();
+}
+
+void ResourceManager::setTextureStreamingEnabled(bool enabled) {
+  textureStreaming = enabled;
+  textureLoader.setRetainSources(enabled);
+}
+
+void ResourceManager::logTextureMemoryReport() const {
+  size_t total = 0;
+  for (const auto& [name, texture] : textures) {
+    LOG_INFO("Texture '", name, "': ", texture->getWidth(), "x",
+             texture->getHeight(), ", resident from level ",
+             texture->getResidentLevel(), ", GPU ",
+             texture->getResidentBytes(), " B");
+    total += texture->getResidentBytes();
+  }
+  size_t arrayBytes = texturePacker.getBytes();
+  LOG_INFO("Texture arrays: ", texturePacker.getArrayCount(), ", GPU ",
+           arrayBytes, " B");
+  total += arrayBytes;
+  const TextureStreamingStats& stats = textureStreamer.getStats();
+  LOG_INFO("Textures total: GPU ", total, " B, budget ",
+           textureStreamer.getBudget(), " B, ", stats.reducedTextures,
+           " streamed below full size");
+}
+
+size_t ResourceManager::packTextures() {
+  std::vector<Texture2D*> candidates;
+  candidates.reserve(textures.size());
+  for (const auto& [name, texture] : textures) {
+    candidates.push_back(texture.get());
+  }
+  return texturePacker.pack(candidates);
 }
 
 std::shared_ptr<FontAtlas> ResourceManager::loadFont(
@@ -110,6 +389,35 @@ std::shared_ptr<Shader> ResourceManager::getShader(const std::string& name) {
   return getResource<Shader>("Shader", shaders, name);
 }
 
+std::shared_ptr<Shader> ResourceManager::getShaderPermutation(
+    const std::string& name, const ShaderDefines& defines) {
+  if (defines.empty()) {
+    return getShader(name);
+  }
+  auto key = std::make_pair(name, defines);
+  auto it = shaderPermutations.find(key);
+  if (it != shaderPermutations.end()) {
+    return it->second;
+  }
+
+  std::shared_ptr<Shader> base = getShader(name);
+  if (!base) {
+    return nullptr;
+  }
+  ShaderDefines merged = defines;
+  merged.insert(base->getDefines().begin(), base->getDefines().end());
+
+  std::string permutationName = name + "[" + describeDefines(defines) + "]";
+  LOG_INFO("Compiling shader permutation ", permutationName);
+  auto shader = std::make_shared<Shader>(base->getVertexPath(),
+                                         base->getFragmentPath(),
+                                         shaderOptions(merged, true));
+  shader->setName(permutationName);
+  watchShader(*shader);
+  shaderPermutations.emplace(std::move(key), shader);
+  return shader;
+}
+
 std::shared_ptr<Mesh> ResourceManager::getMesh(const std::string& name) {
   return getResource<Mesh>("Mesh", meshes, name);
 }
@@ -127,3 +435,25 @@ std::shared_ptr<Material> ResourceManager::getMaterial(
     const std::string& name) {
   return getResource<Material>("Material", materials, name);
 }
+
+void ResourceManager::setMeshPoolEnabled(bool enabled) {
+  if (!enabled) {
+    meshPool.reset();
+  } else if (!meshPool) {
+    meshPool = std::make_shared<MeshPool>();
+  }
+}
+
+void ResourceManager::logMeshMemoryReport() const {
+  size_t totalCpu = 0;
+  size_t totalGpu = 0;
+  for (const auto& [name, mesh] : meshes) {
+    MeshMemoryStats stats = mesh->getMemoryStats();
+    LOG_INFO("Mesh '", name, "': ", mesh->getVerticesCount(), " vertices, ",
+             mesh->getIndicesCount(), " indices, CPU ", stats.cpuBytes,
+             " B, GPU ", stats.gpuBytes, " B");
+    totalCpu += stats.cpuBytes;
+    totalGpu += stats.gpuBytes;
+  }
+  LOG_INFO("Meshes total: CPU ", totalCpu, " B, GPU ", totalGpu, " B");
+}
@@ -1,19 +1,61 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "src/file_watcher.h"
 #include "src/font_atlas.h"
 #include "src/material.h"
 #include "src/mesh.h"
+#include "src/program_cache.h"
 #include "src/shader.h"
 #include "src/texture2d.h"
+#include "src/texture_loader.h"
+#include "src/texture_packer.h"
+#include "src/texture_streamer.h"
+
+/* One program for ResourceManager::loadShaders */
+struct ShaderSource {
+  std::string name;
+  std::filesystem::path vertexPath;
+  std::filesystem::path fragmentPath;
+  ShaderDefines defines = {};
+};
 
 class ResourceManager {
  private:
+  /* Shared by the pooled meshes, which keep it alive past the manager */
+  std::shared_ptr<MeshPool> meshPool;
+  bool meshOptimization;
+
+  ProgramCache programCache;
+  bool programCaching;
+  /* Include cache shared by every shader this manager compiles */
+  ShaderPreprocessor shaderPreprocessor;
+  FileWatcher shaderWatcher;
+  bool shaderHotReload;
+  /* Rebuilds of edited shaders, swapped in once the driver is done */
+  std::vector<std::pair<std::shared_ptr<Shader>, std::unique_ptr<Shader>>>
+      shaderReloads;
+
+  TextureLoader textureLoader;
+  TexturePacker texturePacker;
+  bool texturePacking;
+  /* Set by loads, cleared once they are all uploaded and packed */
+  bool texturesToPack;
+  TextureStreamer textureStreamer;
+  bool textureStreaming;
+  /* Scratch list handed to the streamer every frame */
+  std::vector<Texture2D*> streamedTextures;
+
   std::unordered_map<std::string, std::shared_ptr<Shader>> shaders;
+  /* Keyed by base shader name and the extra defines */
+  std::map<std::pair<std::string, ShaderDefines>, std::shared_ptr<Shader>>
+      shaderPermutations;
   std::unordered_map<std::string, std::shared_ptr<Mesh>> meshes;
   std::unordered_map<std::string, std::shared_ptr<Texture2D>> textures;
   std::unordered_map<std::string, std::shared_ptr<FontAtlas>> fonts;
@@ -25,6 +67,12 @@ class ResourceManager {
       std::unordered_map<std::string, std::shared_ptr<T>>& container,
       const std::string& name, Args&&... args);
 
+  ShaderOptions shaderOptions(const ShaderDefines& defines, bool wait);
+  void watchShader(const Shader& shader);
+  /* Starts recompiling shader if it was built from any of the files */
+  void reloadShaderIfChanged(const std::shared_ptr<Shader>& shader,
+                             const std::vector<std::filesystem::path>& files);
+
   template <typename T>
   std::shared_ptr<T> getResource(
       const std::string& resourceType,
@@ -32,16 +80,85 @@ class ResourceManager {
       const std::string& name);
 
  public:
+  ResourceManager();
+
+  /* Loads the program from the binary cache when enabled and the sources
+     and driver are unchanged since it was stored */
   std::shared_ptr<Shader> loadShader(const std::string& name,
                                      const std::filesystem::path& vertexPath,
                                      const std::filesystem::path& fragmentPath);
 
-  std::shared_ptr<Mesh> loadMesh(const std::string& name,
-                                 const std::vector<Vertex>& vertices,
-                                 const std::vector<unsigned int>& indices);
-
-  std::shared_ptr<Texture2D> loadTexture(
-      const std::string& name, const std::filesystem::path& fragmentPath);
+  /* Issues every compile and link before checking any of them, then
+     finishes programs as the driver reports them done, so compilation
+     overlaps across programs on drivers that thread it. Throws the first
+     failure once every other program is finished; failed ones aren't
+     added, the rest stay loaded. */
+  std::vector<std::shared_ptr<Shader>> loadShaders(
+      const std::vector<ShaderSource>& sources);
+
+  /* Watches the sources and includes of every shader. Edited programs are
+     recompiled without waiting on the driver and swapped into their
+     Shader objects by processShaderReloads(); a failed compile keeps the
+     old program. */
+  void setShaderHotReloadEnabled(bool enabled);
+  /* Call once per frame on the GL thread */
+  void processShaderReloads();
+
+  /* Program binaries are kept under ProgramCache::DEFAULT_DIRECTORY */
+  void setProgramCacheEnabled(bool enabled) { programCaching = enabled; }
+
+  /* Welding and cache reordering in loadMesh(), on by default. Turn it off
+     for meshes whose vertex or triangle order matters. Models are always
+     optimized, once when their cache is built. */
+  void setMeshOptimizationEnabled(bool enabled) {
+    meshOptimization = enabled;
+  }
+
+  /* Welds duplicate vertices, reorders triangles and vertices for the GPU
+     caches (see setMeshOptimizationEnabled) and appends a simplified LOD
+     chain before creating the mesh */
+  std::shared_ptr<Mesh> loadMesh(
+      const std::string& name, std::vector<Vertex> vertices,
+      std::vector<unsigned int> indices,
+      MeshResidency residency = MeshResidency::CPU_AND_GPU,
+      VertexFormat format = VertexFormat::FLOAT32);
+
+  /* Loads an OBJ model. The processed mesh is written next to the model as
+     <path>.meshcache and mapped straight into GPU buffers on later runs */
+  std::shared_ptr<Mesh> loadModel(
+      const std::string& name, const std::filesystem::path& path,
+      VertexFormat format = VertexFormat::FLOAT32);
+
+  /* Returns at once with a placeholder image. The file is decoded in the
+     background and uploaded by processTextureUploads(). Pass srgb = false
+     for data textures so their mipmaps are averaged without gamma. */
+  std::shared_ptr<Texture2D> loadTexture(const std::string& name,
+                                         const std::filesystem::path& path,
+                                         bool srgb = true);
+
+  /* Uploads finished texture decodes, spending at most about budgetMs.
+     Call once per frame on the GL thread. With packing enabled, textures
+     are packed once no more loads are pending. With streaming enabled, mip
+     levels are then streamed in and out to fit the texture budget. */
+  void processTextureUploads(float budgetMs = 2.0f);
+
+  /* Packs loaded textures into shared arrays, see TexturePacker. Materials
+     whose shader declares layeredMaterial then sample those by layer. */
+  void setTexturePackingEnabled(bool enabled) { texturePacking = enabled; }
+  size_t packTextures();
+  size_t pendingTextureCount() const { return textureLoader.pendingCount(); }
+
+  /* Keeps a CPU copy of textures loaded from now on and lets
+     TextureStreamer drop their largest levels when they are small on screen,
+     unused or over the budget */
+  void setTextureStreamingEnabled(bool enabled);
+  void setTextureBudget(size_t bytes) { textureStreamer.setBudget(bytes); }
+  const TextureStreamingStats& getTextureStreamingStats() const {
+    return textureStreamer.getStats();
+  }
+
+  /* Logs the resident level and GPU memory of every loaded texture */
+  void logTextureMemoryReport() const;
 
   std::shared_ptr<FontAtlas> loadFont(const std::string& name,
                                       const std::filesystem::path& path,
@@ -57,6 +174,12 @@ class ResourceManager {
 
   std::shared_ptr<Shader> getShader(const std::string& name);
 
+  /* The named shader compiled with extra defines (overriding its own),
+     e.g. {{"HAS_SPECULAR_MAP", ""}}. Built on first use, then cached per
+     define set. Returns nullptr if the base shader doesn't exist. */
+  std::shared_ptr<Shader> getShaderPermutation(const std::string& name,
+                                               const ShaderDefines& defines);
+
   std::shared_ptr<Mesh> getMesh(const std::string& name);
 
   std::shared_ptr<Texture2D> getTexture(const std::string& name);
@@ -64,6 +187,14 @@ class ResourceManager {
   std::shared_ptr<FontAtlas> getFont(const std::string& name);
 
   std::shared_ptr<Material> getMaterial(const std::string& name);
+
+  /* When enabled, meshes loaded from now on share the buffers of one
+     MeshPool instead of owning a VAO/VBO/EBO each */
+  void setMeshPoolEnabled(bool enabled);
+  MeshPool* getMeshPool() const { return meshPool.get(); }
+
+  /* Logs CPU and GPU memory held by every loaded mesh */
+  void logMeshMemoryReport() const;
 };
 
 #endif /* RESOURCE_MANAGER_H */
@@ -5,7 +5,7 @@
 
 #include "src/component.h"
 
-class RotationComponent : public Component {
+class RotationComponent final : public Component {
  private:
   glm::vec3 axis;
   float angularSpeed;
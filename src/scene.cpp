@@ -1,90 +1,344 @@
 #include "src/scene.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
 #include <memory>
+#include <tuple>
 
 #include "src/directional_light_component.h"
 #include "src/game_object.h"
 #include "src/light_component.h"
 #include "src/point_light_component.h"
 #include "src/spotlight_component.h"
+#include "src/text_mesh.h"
+#include "src/texture_array.h"
 
 void Scene::update(float deltaTime) {
   forEachObject([deltaTime](GameObject* obj) { obj->update(deltaTime); });
 }
 
 int priority(bool opaque) {
-  /* 0 if opaque, 1 otherwise */
-  return !opaque;
+  return opaque ? OPAQUE_PRIORITY : TRANSPARENT_PRIORITY;
 }
 
 /* Probably better if grouped by shader and not material */
-std::map<std::pair<int, Material*>, std::vector<GameObject*>>
-Scene::groupByMaterial() {
-  std::map<std::pair<int, Material*>, std::vector<GameObject*>> groups;
+RenderQueue Scene::groupByMaterial() {
+  RenderQueue groups;
+  /* Layered materials read their textures per draw, so the first one seen
+     for a shader and pair of arrays stands in for all of them */
+  std::map<std::tuple<int, Shader*, const TextureArray*, const TextureArray*>,
+           Material*>
+      layeredKeys;
 
-  forEachObject([&groups](GameObject* obj) {
+  forEachObject([&groups, &layeredKeys](GameObject* obj) {
     Material* mat = obj->getMaterial().get();
-    if (mat) {
-      groups[std::make_pair(priority(mat->isOpaque()), mat)].push_back(obj);
+    if (!mat) {
+      return;
     }
+    int matPriority = priority(mat->isOpaque());
+    if (mat->isLayered() &&
+        IndirectRenderer::isBatchable(mat->getShader().get())) {
+      const TextureSlot* specular =
+          mat->getSpecular() ? mat->getSpecular()->getSlot() : nullptr;
+      auto key = std::make_tuple(matPriority, mat->getShader().get(),
+                                 mat->getTexture()->getSlot()->array.get(),
+                                 specular ? specular->array.get() : nullptr);
+      mat = layeredKeys.try_emplace(key, mat).first->second;
+    }
+    groups[std::make_pair(matPriority, mat)].push_back(obj);
   });
 
   return groups;
 }
 
-std::vector<LightComponent*> Scene::collectLights() {
-  std::vector<LightComponent*> lights;
+void Scene::selectLods(const Camera& camera, float viewportHeight) {
+  /* Screen-height fraction covered by one unit at distance one */
+  float screenScale =
+      1.0F / (2.0F * std::tan(glm::radians(camera.getFov()) * 0.5F));
+  glm::vec3 cameraPosition = camera.getPosition();
+
+  forEachObject([&](GameObject* obj) {
+    const Mesh* mesh = obj->getMesh().get();
+    if (!mesh) {
+      return;
+    }
 
-  forEachObject([&lights](GameObject* obj) {
-    for (LightComponent* light : obj->getComponents<LightComponent>()) {
-      if (light->isEnabled()) {
-        lights.push_back(light);
+    glm::vec3 center;
+    float radius;
+    obj->getWorldBoundingSphere(center, radius);
+    float distance = std::max(glm::length(center - cameraPosition) - radius,
+                              camera.getNearPlane());
+
+    /* Assumes the textures span the object once, so they need about as
+       many texels as the object covers pixels */
+    const Material* material = obj->getMaterial().get();
+    if (material) {
+      float pixels = 2.0F * radius * screenScale / distance * viewportHeight;
+      if (material->getTexture()) {
+        material->getTexture()->requestScreenSize(pixels);
+      }
+      if (material->getSpecular()) {
+        material->getSpecular()->requestScreenSize(pixels);
       }
     }
+
+    if (mesh->getLodCount() < 2) {
+      return;
+    }
+    float meshScale = mesh->getBoundsRadius() > 0.0F
+                          ? radius / mesh->getBoundsRadius()
+                          : 1.0F;
+    float errorToScreen = meshScale * screenScale / distance;
+
+    size_t lod = std::min(obj->getLodLevel(), mesh->getLodCount() - 1);
+    while (lod + 1 < mesh->getLodCount() &&
+           mesh->getLod(lod + 1).error * errorToScreen <
+               LOD_ERROR_THRESHOLD * LOD_HYSTERESIS) {
+      lod++;
+    }
+    while (lod > 0 &&
+           mesh->getLod(lod).error * errorToScreen > LOD_ERROR_THRESHOLD) {
+      lod--;
+    }
+    obj->setLodLevel(lod);
   });
+}
+
+void Scene::registerLight(LightComponent* light) {
+  switch (light->getLightType()) {
+    case LightType::DIRECTIONAL:
+      dirLights.push_back(static_cast<DirectionalLightComponent*>(light));
+      break;
+    case LightType::POINT:
+      pointLights.push_back(static_cast<PointLightComponent*>(light));
+      break;
+    case LightType::SPOT:
+      spotLights.push_back(static_cast<SpotlightComponent*>(light));
+      break;
+  }
+}
+
+void Scene::unregisterLight(LightComponent* light) {
+  /* The light may be partially destroyed, and converting the stored
+     derived pointers to LightComponent* would then be undefined. Compare
+     bare addresses instead; every light derives from LightComponent
+     alone, so both point at the start of the object. */
+  const void* address = static_cast<const void*>(light);
+  auto eraseFrom = [address](auto& lights) {
+    std::erase_if(lights, [address](const auto* l) {
+      return static_cast<const void*>(l) == address;
+    });
+  };
+
+  switch (light->getLightType()) {
+    case LightType::DIRECTIONAL:
+      eraseFrom(dirLights);
+      break;
+    case LightType::POINT:
+      eraseFrom(pointLights);
+      break;
+    case LightType::SPOT:
+      eraseFrom(spotLights);
+      break;
+  }
+}
+
+void Scene::setDirLightUniforms(Shader* shader) {
+  int numDir = std::min<int>(dirLights.size(), 8);
+  for (int i = 0; i < numDir; i++) {
+    dirLights[i]->setUniforms(shader, i);
+  }
+  shader->setUniform("numDirLights", numDir);
+}
+
+void Scene::gatherLightCandidates() {
+  auto makeCandidate = [](auto* light) {
+    auto maxChannel = [](const glm::vec3& c) {
+      return glm::max(c.x, glm::max(c.y, c.z));
+    };
+    LightCandidate candidate;
+    candidate.position = light->getGameObject()->getWorldPosition();
+    candidate.range = light->getRange();
+    candidate.intensity = glm::max(
+        maxChannel(light->getAmbient()),
+        glm::max(maxChannel(light->getDiffuse()),
+                 maxChannel(light->getSpecular())));
+    candidate.constant = light->getConstant();
+    candidate.linear = light->getLinear();
+    candidate.quadratic = light->getQuadratic();
+    return candidate;
+  };
+
+  pointCandidates.clear();
+  for (PointLightComponent* light : pointLights) {
+    pointCandidates.push_back(makeCandidate(light));
+  }
+  spotCandidates.clear();
+  for (SpotlightComponent* light : spotLights) {
+    spotCandidates.push_back(makeCandidate(light));
+  }
+}
+
+void Scene::selectLights(const std::vector<LightCandidate>& candidates,
+                         const glm::vec3& center, float radius,
+                         std::vector<int>& selected) {
+  scoredLights.clear();
+  for (size_t i = 0; i < candidates.size(); i++) {
+    const LightCandidate& light = candidates[i];
+    float distance =
+        glm::max(glm::length(light.position - center) - radius, 0.0F);
+    if (distance > light.range) {
+      continue;
+    }
+    float attenuation =
+        1.0F / (light.constant + light.linear * distance +
+                light.quadratic * distance * distance);
+    scoredLights.emplace_back(light.intensity * attenuation, i);
+  }
+
+  size_t count = std::min(scoredLights.size(), MAX_FORWARD_LIGHTS);
+  std::partial_sort(scoredLights.begin(), scoredLights.begin() + count,
+                    scoredLights.end(), std::greater<>());
+
+  selected.clear();
+  for (size_t i = 0; i < count; i++) {
+    selected.push_back(scoredLights[i].second);
+  }
+}
 
-  LOG_DEBUG("Collected ", lights.size(), " lights");
-  return lights;
+void Scene::setObjectLightUniforms(Shader* shader, GameObject* obj,
+                                   bool force) {
+  glm::vec3 center;
+  float radius;
+  obj->getWorldBoundingSphere(center, radius);
+  LOG_DEBUG("Lights for ", obj->getName());
+  setLightUniforms(shader, center, radius, force);
 }
 
-void Scene::setLightUniforms(Shader* shader) {
-  std::vector<LightComponent*> lights = collectLights();
+void Scene::setLightUniforms(Shader* shader, const glm::vec3& center,
+                             float radius, bool force) {
+  selectLights(pointCandidates, center, radius, selectedPoint);
+  selectLights(spotCandidates, center, radius, selectedSpot);
+
+  if (!force && selectedPoint == uploadedPoint &&
+      selectedSpot == uploadedSpot) {
+    return;
+  }
 
-  int numDir = 0, numPoint = 0, numSpot = 0;
+  for (size_t i = 0; i < selectedPoint.size(); i++) {
+    pointLights[selectedPoint[i]]->setUniforms(shader, i);
+  }
+  for (size_t i = 0; i < selectedSpot.size(); i++) {
+    spotLights[selectedSpot[i]]->setUniforms(shader, i);
+  }
 
-  /* TODO: Collect max lights number from the shader */
-  for (LightComponent* light : lights) {
-    if (DirectionalLightComponent* dirLight =
-            dynamic_cast<DirectionalLightComponent*>(light)) {
-      if (numDir < 8) {
-        dirLight->setUniforms(shader, numDir);
-        numDir++;
+  LOG_DEBUG("Selected lights: ", selectedPoint.size(), " ",
+            selectedSpot.size());
+  shader->setUniform("numPointLights", static_cast<int>(selectedPoint.size()));
+  shader->setUniform("numSpotLights", static_cast<int>(selectedSpot.size()));
+
+  uploadedPoint = selectedPoint;
+  uploadedSpot = selectedSpot;
+}
+
+/* Smallest sphere enclosing both, or nothing when neither fits inside
+   maxRadius */
+static bool mergeSpheres(const glm::vec3& centerA, float radiusA,
+                         const glm::vec3& centerB, float radiusB,
+                         float maxRadius, glm::vec3& center, float& radius) {
+  float distance = glm::length(centerB - centerA);
+  if (distance + radiusB <= radiusA) {
+    center = centerA;
+    radius = radiusA;
+  } else if (distance + radiusA <= radiusB) {
+    center = centerB;
+    radius = radiusB;
+  } else {
+    radius = (distance + radiusA + radiusB) * 0.5F;
+    center = centerA + (centerB - centerA) * ((radius - radiusA) / distance);
+  }
+  return radius <= maxRadius;
+}
+
+void Scene::drawTextBatch(Shader* shader,
+                          const std::vector<GameObject*>& group,
+                          bool forwardLit) {
+  auto queueText = [this](GameObject* obj, TextMesh* text) {
+    const MaterialPropertyBlock& properties = obj->getPropertyBlock();
+    textBatcher.add(
+        *text, obj->getModelMatrix(),
+        properties.resolveColor(obj->getMaterial()->getBaseColor()));
+  };
+  size_t clusterCount = 0;
+
+  for (GameObject* obj : group) {
+    auto* text = dynamic_cast<TextMesh*>(obj->getMesh().get());
+    if (!text) {
+      /* Other meshes lack the glyph layout the shader expects */
+      if (nonTextObjects.insert(obj->getId()).second) {
+        LOG_WARNING("Object ", obj->getName(),
+                    " uses a text shader without a TextMesh, not drawn");
       }
-    } else if (PointLightComponent* pointLight =
-                   dynamic_cast<PointLightComponent*>(light)) {
-      if (numPoint < 8) {
-        pointLight->setUniforms(shader, numPoint);
-        numPoint++;
+      continue;
+    }
+    if (!forwardLit) {
+      queueText(obj, text);
+      continue;
+    }
+
+    glm::vec3 center;
+    float radius;
+    obj->getWorldBoundingSphere(center, radius);
+    TextCluster* target = nullptr;
+    for (size_t i = 0; i < clusterCount && !target; i++) {
+      TextCluster& cluster = textClusters[i];
+      glm::vec3 mergedCenter;
+      float mergedRadius;
+      if (mergeSpheres(cluster.center, cluster.radius, center, radius,
+                       MAX_TEXT_BATCH_RADIUS, mergedCenter, mergedRadius)) {
+        cluster.center = mergedCenter;
+        cluster.radius = mergedRadius;
+        target = &cluster;
       }
-    } else if (SpotlightComponent* spotLight =
-                   dynamic_cast<SpotlightComponent*>(light)) {
-      if (numSpot < 8) {
-        spotLight->setUniforms(shader, numSpot);
-        numSpot++;
+    }
+    if (!target) {
+      /* Reuses the vectors of previous frames */
+      if (clusterCount == textClusters.size()) {
+        textClusters.emplace_back();
       }
+      target = &textClusters[clusterCount++];
+      target->center = center;
+      target->radius = radius;
+      target->objects.clear();
     }
+    target->objects.push_back(obj);
   }
 
-  LOG_DEBUG("Number of lights: ", numDir, " ", numPoint, " ", numSpot);
-  shader->setUniform("numDirLights", numDir);
-  shader->setUniform("numPointLights", numPoint);
-  shader->setUniform("numSpotLights", numSpot);
+  if (!forwardLit) {
+    textBatcher.flush(shader);
+    return;
+  }
+  for (size_t i = 0; i < clusterCount; i++) {
+    const TextCluster& cluster = textClusters[i];
+    for (GameObject* obj : cluster.objects) {
+      /* Checked above */
+      queueText(obj, static_cast<TextMesh*>(obj->getMesh().get()));
+    }
+    setLightUniforms(shader, cluster.center, cluster.radius, i == 0);
+    textBatcher.flush(shader);
+  }
 }
 
 bool needsLightning(Shader* shader) {
   return shader->hasUniform("numSpotLights");
 }
 
+bool needsClusteredLightning(Shader* shader) {
+  return shader->hasUniform("clusterGrid");
+}
+
 bool needsCameraPosition(Shader* shader) {
   return shader->hasUniform("viewPos");
 }
@@ -96,24 +350,69 @@ void Scene::render() {
   const glm::mat4& projectionMatrix = camera->getProjectionMatrix();
   const glm::vec3 cameraPosition = camera->getPosition();
 
-  std::map<std::pair<int, Material*>, std::vector<GameObject*>> groups =
-      groupByMaterial();
+  RenderQueue groups = groupByMaterial();
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  selectLods(*camera, static_cast<float>(viewport[3]));
+
+  shadowRenderer.render(*camera, groups, dirLights, spotLights);
+  indirectRenderer.beginFrame();
+
+  /* Built lazily, only if some shader in this frame consumes them */
+  bool clustersUpdated = false;
+  bool candidatesGathered = false;
+  size_t groupIndex = 0;
 
   for (auto [key, group] : groups) {
     auto material = key.second;
+    float materialIndex = static_cast<float>(groupIndex++);
 
     Shader* shader = material->getShader().get();
     material->bind();
     shader->setUniform("view", viewMatrix);
     shader->setUniform("projection", projectionMatrix);
 
-    if (needsLightning(shader)) {
-      setLightUniforms(shader);
+    bool clustered = needsClusteredLightning(shader);
+    bool forwardLit = !clustered && needsLightning(shader);
+
+    if (clustered) {
+      if (!clustersUpdated) {
+        lightClusters.update(*camera, pointLights, spotLights);
+        clustersUpdated = true;
+      }
+      setDirLightUniforms(shader);
+      lightClusters.bind(shader);
+    }
+    if (forwardLit) {
+      if (!candidatesGathered) {
+        gatherLightCandidates();
+        candidatesGathered = true;
+      }
+      setDirLightUniforms(shader);
+    }
+    if (clustered || forwardLit) {
+      shadowRenderer.bind(shader);
     }
     if (needsCameraPosition(shader)) {
       shader->setUniform("viewPos", cameraPosition);
     }
+
+    if (TextBatcher::isBatchable(shader)) {
+      drawTextBatch(shader, group, forwardLit);
+      continue;
+    }
+    /* Per-object light uniforms rule out batching forward-lit groups */
+    if (!forwardLit && IndirectRenderer::isBatchable(shader)) {
+      indirectRenderer.draw(shader, group, materialIndex);
+      continue;
+    }
+
+    bool firstInGroup = true;
     for (GameObject* obj : group) {
+      if (forwardLit) {
+        setObjectLightUniforms(shader, obj, firstInGroup);
+        firstInGroup = false;
+      }
       obj->drawGeometry();
     }
   }
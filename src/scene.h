@@ -3,24 +3,107 @@
 
 #include <map>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "src/camera.h"
 #include "src/game_object.h"
-#include "src/light_component.h"
+#include "src/indirect_renderer.h"
+#include "src/light_clusters.h"
+#include "src/render_queue.h"
+#include "src/shadow_renderer.h"
+#include "src/text_batcher.h"
+
+class LightComponent;
+class DirectionalLightComponent;
+class PointLightComponent;
+class SpotlightComponent;
 
 class Scene {
+ public:
+  /* Matches MAX_POINT_LIGHTS / MAX_SPOT_LIGHTS in shaders/light_incl.frag */
+  static constexpr size_t MAX_FORWARD_LIGHTS = 8;
+
+  /* Largest LOD error allowed on screen, as a fraction of the viewport
+     height (about a pixel at 1080p) */
+  static constexpr float LOD_ERROR_THRESHOLD = 0.001F;
+  /* A coarser LOD is only taken once its error is this far below the
+     threshold, so objects near a boundary don't flip every frame */
+  static constexpr float LOD_HYSTERESIS = 0.5F;
+
+  /* Forward-lit texts share one light selection per batch, so a batch is
+     kept within a sphere of this radius to still pick the lights near it */
+  static constexpr float MAX_TEXT_BATCH_RADIUS = 2.0F;
+
  private:
+  /* Forward-lit texts drawn with one light selection */
+  struct TextCluster {
+    glm::vec3 center;
+    float radius;
+    std::vector<GameObject*> objects;
+  };
+
+  /* Per-frame summary of a point or spot light for per-object culling */
+  struct LightCandidate {
+    glm::vec3 position;
+    float range;
+    float intensity;
+    float constant;
+    float linear;
+    float quadratic;
+  };
+
+  /* Enabled lights, kept up to date by LightComponent. Declared before
+     rootObjects so they outlive the components that unregister from them. */
+  std::vector<DirectionalLightComponent*> dirLights;
+  std::vector<PointLightComponent*> pointLights;
+  std::vector<SpotlightComponent*> spotLights;
+
   std::vector<std::unique_ptr<GameObject>> rootObjects;
   std::vector<Camera*> cameras;
   size_t activeCameraIdx;
 
-  std::map<std::pair<int, Material*>, std::vector<GameObject*>>
-  groupByMaterial();
+  LightClusters lightClusters;
+  ShadowRenderer shadowRenderer;
+  IndirectRenderer indirectRenderer;
+  TextBatcher textBatcher;
+
+  std::vector<LightCandidate> pointCandidates;
+  std::vector<LightCandidate> spotCandidates;
+  /* Scratch buffers reused across objects to avoid per-draw allocations */
+  std::vector<std::pair<float, int>> scoredLights;
+  std::vector<int> selectedPoint, selectedSpot;
+  std::vector<int> uploadedPoint, uploadedSpot;
+  std::vector<TextCluster> textClusters;
+  /* Objects already reported for using a text shader without a TextMesh */
+  std::unordered_set<uint64_t> nonTextObjects;
+
+  RenderQueue groupByMaterial();
+
+  /* Picks every object's LOD from its projected error and tells its
+     textures how many pixels they cover, for TextureStreamer */
+  void selectLods(const Camera& camera, float viewportHeight);
+
+  void setDirLightUniforms(Shader* shader);
 
-  std::vector<LightComponent*> collectLights();
+  void gatherLightCandidates();
 
-  void setLightUniforms(Shader* shader);
+  /* Picks the MAX_FORWARD_LIGHTS brightest lights reaching the sphere */
+  void selectLights(const std::vector<LightCandidate>& candidates,
+                    const glm::vec3& center, float radius,
+                    std::vector<int>& selected);
+
+  /* Uploads the lights relevant to the sphere, skipped if the selection
+     matches the previous upload to the same shader unless force is set */
+  void setLightUniforms(Shader* shader, const glm::vec3& center, float radius,
+                        bool force);
+  void setObjectLightUniforms(Shader* shader, GameObject* obj, bool force);
+
+  /* Draws the group's texts through textBatcher. Forward-lit texts are
+     split into clusters no wider than MAX_TEXT_BATCH_RADIUS, each drawn
+     with the lights selected for its bounding sphere */
+  void drawTextBatch(Shader* shader, const std::vector<GameObject*>& group,
+                     bool forwardLit);
 
   template <typename Func>
   void forEachObject(Func func) {
@@ -35,6 +118,11 @@ class Scene {
 
   void setActiveCamera(size_t index) { activeCameraIdx = index; }
 
+  /* Enables shadow mapping, the shader renders depth for a light matrix */
+  void setShadowShader(std::shared_ptr<Shader> shader) {
+    shadowRenderer.setDepthShader(std::move(shader));
+  }
+
   Camera* getActiveCamera() { return cameras[activeCameraIdx]; }
 
   void update(float deltaTime);
@@ -42,12 +130,14 @@ class Scene {
   void render();
 
   void addObject(std::unique_ptr<GameObject> obj) {
+    obj->setScene(this);
     rootObjects.push_back(std::move(obj));
   }
 
   void addCamera(std::unique_ptr<Camera> cam) {
     Camera* camPtr = cam.get();
     cameras.push_back(camPtr);
+    cam->setScene(this);
     rootObjects.push_back(std::move(cam));
   }
 
@@ -58,6 +148,20 @@ class Scene {
 
   std::vector<Camera*>& getAllCameras() { return cameras; }
 
+  /* Called by LightComponent when it becomes (in)active in this scene */
+  void registerLight(LightComponent* light);
+  void unregisterLight(LightComponent* light);
+
+  const std::vector<DirectionalLightComponent*>& getDirectionalLights() const {
+    return dirLights;
+  }
+  const std::vector<PointLightComponent*>& getPointLights() const {
+    return pointLights;
+  }
+  const std::vector<SpotlightComponent*>& getSpotLights() const {
+    return spotLights;
+  }
+
   /* Find maximum GameObject ID in scene (for post-deserialization) */
   uint64_t findMaxGameObjectId() const;
 
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <utility>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -15,58 +16,51 @@
 #include "src/logger.h"
 #include "src/utils.h"
 
-std::string readSourceFile(const std::filesystem::path& path) {
-  std::string code;
-  std::ifstream sourceFile;
-
-  LOG_INFO("Opening shader", path);
-
-  sourceFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  try {
-    sourceFile.open(path);
-    std::stringstream shaderStream;
-    shaderStream << sourceFile.rdbuf();
-    sourceFile.close();
-    code = shaderStream.str();
-  } catch (std::ifstream::failure& e) {
-    LOG_ERROR("Cannot open shader under ", path, ": ", strerror(errno));
-    throw;
-  }
+/* Compiles and links are only issued here and checked later, so drivers
+   with parallel compilation can work on several programs at once */
+static GLuint issueCompile(const std::string& source, GLuint shaderType) {
+  unsigned int shader = glCreateShader(shaderType);
+  const char* str = source.c_str();
 
-  return code;
+  glShaderSource(shader, 1, &str, NULL);
+  glCompileShader(shader);
+  return shader;
 }
 
-GLuint compileShader(const std::string& source, GLuint shaderType) {
+static void checkCompile(GLuint shader, GLuint shaderType,
+                         const std::vector<std::filesystem::path>& files) {
   int success;
   char infoLog[512];
   std::string shaderTypeString =
       shaderType == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT";
 
-  unsigned int shader = glCreateShader(shaderType);
-  const char* str = source.c_str();
-
-  glShaderSource(shader, 1, &str, NULL);
-  glCompileShader(shader);
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 
   if (!success) {
     glGetShaderInfoLog(shader, 512, NULL, infoLog);
-    LOG_ERROR("Shader compilation failed: ", infoLog);
-    throw ShaderCompilationException(infoLog);
+    std::string log = ShaderPreprocessor::mapErrorLog(infoLog, files);
+    LOG_ERROR(shaderTypeString, " shader compilation failed: ", log);
+    throw ShaderCompilationException(log);
   }
-
-  return shader;
 }
 
-GLuint linkProgram(unsigned int vertexShader, unsigned int fragmentShader) {
-  int success;
-  char infoLog[512];
-
+static GLuint issueLink(unsigned int vertexShader, unsigned int fragmentShader,
+                        bool retrievable) {
   unsigned int shaderProgram = glCreateProgram();
   glAttachShader(shaderProgram, vertexShader);
   glAttachShader(shaderProgram, fragmentShader);
+  if (retrievable) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
 
   glLinkProgram(shaderProgram);
+  return shaderProgram;
+}
+
+static void checkLink(GLuint shaderProgram) {
+  int success;
+  char infoLog[512];
 
   glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
   if (!success) {
@@ -74,63 +68,122 @@ GLuint linkProgram(unsigned int vertexShader, unsigned int fragmentShader) {
     LOG_ERROR("Shader linking failed: ", infoLog);
     throw ShaderCompilationException(infoLog);
   }
-
-  return shaderProgram;
 }
 
-std::string loadShaderWithIncludes(const std::filesystem::path& path) {
-  std::stringstream result;
-  std::ifstream sourceFile;
-  LOG_INFO("Opening shader with includes: ", path);
-  sourceFile.exceptions(std::ifstream::badbit);
-
-  try {
-    sourceFile.open(path);
-    std::string line;
-    while (std::getline(sourceFile, line)) {
-      if (line.find("#include") != std::string::npos) {
-        size_t start = line.find('"');
-        if (start != std::string::npos) {
-          start++;
-          size_t end = line.find('"', start);
-          if (end != std::string::npos) {
-            std::string includePath = line.substr(start, end - start);
-            std::filesystem::path includeFullPath =
-                path.parent_path() / includePath;
-
-            result << loadShaderWithIncludes(includeFullPath);
-            continue;
-          }
-        }
-      }
-      result << line << "\n";
+Shader::Shader(const std::filesystem::path& vertexPath,
+               const std::filesystem::path& fragmentPath,
+               const ShaderOptions& options)
+    : vertexPath(vertexPath),
+      fragmentPath(fragmentPath),
+      defines(options.defines),
+      pendingVertex(0),
+      pendingFragment(0),
+      pendingCache(nullptr),
+      cacheKey(0) {
+  ShaderPreprocessor localPreprocessor;
+  ShaderPreprocessor& preprocessor =
+      options.preprocessor ? *options.preprocessor : localPreprocessor;
+  PreprocessedShader vertex = preprocessor.process(vertexPath, defines);
+  PreprocessedShader fragment = preprocessor.process(fragmentPath, defines);
+  const std::string& vShaderCode = vertex.source;
+  const std::string& fShaderCode = fragment.source;
+  vertexFiles = std::move(vertex.files);
+  fragmentFiles = std::move(fragment.files);
+
+  ProgramCache* cache = options.cache;
+
+  bool cached = cache && cache->isSupported();
+  if (cached) {
+    cacheKey = cache->keyFor(vShaderCode, fShaderCode);
+    id = cache->load(cacheKey);
+    if (id) {
+      LOG_INFO("Loaded program binary for ", vertexPath, ", ", fragmentPath);
+      return;
     }
+    pendingCache = cache;
+  }
 
-    sourceFile.close();
-  } catch (std::ifstream::failure& e) {
-    LOG_ERROR("Failed reading shader under ", path, ": ", strerror(errno));
-    throw;
+  pendingVertex = issueCompile(vShaderCode, GL_VERTEX_SHADER);
+  pendingFragment = issueCompile(fShaderCode, GL_FRAGMENT_SHADER);
+  id = issueLink(pendingVertex, pendingFragment, cached);
+  if (options.wait) {
+    finish();
   }
+}
 
-  return result.str();
+bool Shader::isReady() const {
+  if (!isPending() || !GLEW_KHR_parallel_shader_compile) {
+    return true;
+  }
+  GLint done = GL_FALSE;
+  glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &done);
+  return done == GL_TRUE;
 }
 
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
-  std::string vShaderCode = loadShaderWithIncludes(vertexPath);
-  std::string fShaderCode = loadShaderWithIncludes(fragmentPath);
-  GLuint vertexShader = compileShader(vShaderCode, GL_VERTEX_SHADER);
-  GLuint fragmentShader = compileShader(fShaderCode, GL_FRAGMENT_SHADER);
-  GLuint shaderProgram = linkProgram(vertexShader, fragmentShader);
+void Shader::finish() {
+  if (!isPending()) {
+    return;
+  }
+  GLuint vertexShader = pendingVertex;
+  GLuint fragmentShader = pendingFragment;
+  pendingVertex = 0;
+  pendingFragment = 0;
+
+  try {
+    checkCompile(vertexShader, GL_VERTEX_SHADER, vertexFiles);
+    checkCompile(fragmentShader, GL_FRAGMENT_SHADER, fragmentFiles);
+    checkLink(id);
+  } catch (const ShaderCompilationException&) {
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glDeleteProgram(id);
+    id = 0;
+    throw;
+  }
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
 
-  id = shaderProgram;
+  if (pendingCache) {
+    pendingCache->store(cacheKey, id);
+    pendingCache = nullptr;
+  }
 }
 
 Shader::~Shader() {
+  if (isPending()) {
+    glDeleteShader(pendingVertex);
+    glDeleteShader(pendingFragment);
+  }
   glDeleteProgram(id);
 }
 
+std::vector<std::filesystem::path> Shader::getSourceFiles() const {
+  std::vector<std::filesystem::path> files = vertexFiles;
+  files.insert(files.end(), fragmentFiles.begin(), fragmentFiles.end());
+  return files;
+}
+
+void Shader::swapProgram(Shader& rebuilt) {
+  std::swap(id, rebuilt.id);
+  std::swap(vertexFiles, rebuilt.vertexFiles);
+  std::swap(fragmentFiles, rebuilt.fragmentFiles);
+  /* Locations belong to the old program; other shaders' caches stay */
+  uniformLocations.clear();
+  rebuilt.uniformLocations.clear();
+  uniformBlockBindings.clear();
+  rebuilt.uniformBlockBindings.clear();
+}
+
+GLint Shader::getUniformLocation(const std::string& name) const {
+  auto it = uniformLocations.find(name);
+  if (it != uniformLocations.end()) {
+    return it->second;
+  }
+  GLint location = glGetUniformLocation(id, name.c_str());
+  uniformLocations.emplace(name, location);
+  return location;
+}
+
 void Shader::use() {
   LOG_DEBUG("Using shader ", name);
   glUseProgram(id);
@@ -145,40 +198,75 @@ void Shader::setUniform(const std::string& name, int val) {
     LOG_ERROR("Shader ", id, " not active when setting '", name, "'");
     return;
   }
-  if (glGetUniformLocation(id, name.c_str()) == -1) {
+  if (getUniformLocation(name) == -1) {
     LOG_WARNING(this->name, ": Can't find uniform " + name);
   }
 
-  glUniform1i(glGetUniformLocation(id, name.c_str()), val);
+  glUniform1i(getUniformLocation(name), val);
   checkGLError("after setUniform(int) for name " + name);
 }
 
 void Shader::setUniform(const std::string& name, const glm::mat4& mat4) {
-  if (glGetUniformLocation(id, name.c_str()) == -1) {
+  if (getUniformLocation(name) == -1) {
     LOG_WARNING("Can't find uniform " + name);
   }
-  glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE,
+  glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE,
                      glm::value_ptr(mat4));
   checkGLError("after setUniform(mat4) for name " + name);
 }
 
 void Shader::setUniform(const std::string& name, const glm::vec3& vec3) {
-  if (glGetUniformLocation(id, name.c_str()) == -1) {
+  if (getUniformLocation(name) == -1) {
     LOG_WARNING("Can't find uniform ", name);
   }
-  glUniform3f(glGetUniformLocation(id, name.c_str()), vec3.x, vec3.y, vec3.z);
+  glUniform3f(getUniformLocation(name), vec3.x, vec3.y, vec3.z);
   checkGLError("after setUniform(vec3) for name " + name);
 }
 
+void Shader::setUniform(const std::string& name, const glm::vec2& vec2) {
+  if (getUniformLocation(name) == -1) {
+    LOG_WARNING("Can't find uniform ", name);
+  }
+  glUniform2f(getUniformLocation(name), vec2.x, vec2.y);
+  checkGLError("after setUniform(vec2) for name " + name);
+}
+
+void Shader::setUniform(const std::string& name, const glm::vec4& vec4) {
+  if (getUniformLocation(name) == -1) {
+    LOG_WARNING("Can't find uniform ", name);
+  }
+  glUniform4f(getUniformLocation(name), vec4.x, vec4.y, vec4.z, vec4.w);
+  checkGLError("after setUniform(vec4) for name " + name);
+}
+
 void Shader::setUniform(const std::string& name, float val) {
-  if (glGetUniformLocation(id, name.c_str()) == -1) {
+  if (getUniformLocation(name) == -1) {
     LOG_WARNING("Can't find uniform ", name);
   }
-  glUniform1f(glGetUniformLocation(id, name.c_str()), val);
+  glUniform1f(getUniformLocation(name), val);
   checkGLError("after setUniform(float) for name " + name);
 }
 
 bool Shader::hasUniform(const std::string& name) const {
-  GLint location = glGetUniformLocation(id, name.c_str());
+  GLint location = getUniformLocation(name);
   return location != -1;
 }
+
+bool Shader::bindUniformBlock(const std::string& name, GLuint binding) {
+  auto it = uniformBlockBindings.find(name);
+  if (it != uniformBlockBindings.end() && it->second == binding) {
+    return true;
+  }
+  if (it != uniformBlockBindings.end() && it->second == GL_INVALID_INDEX) {
+    return false;
+  }
+
+  GLuint index = glGetUniformBlockIndex(id, name.c_str());
+  if (index == GL_INVALID_INDEX) {
+    uniformBlockBindings[name] = GL_INVALID_INDEX;
+    return false;
+  }
+  glUniformBlockBinding(id, index, binding);
+  uniformBlockBindings[name] = binding;
+  return true;
+}
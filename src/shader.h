@@ -4,27 +4,93 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <filesystem>
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/program_cache.h"
+#include "src/shader_preprocessor.h"
+
+struct ShaderOptions {
+  /* Loads and stores program binaries, see ProgramCache */
+  ProgramCache* cache = nullptr;
+  /* Shares cached includes between shaders, a private one when null */
+  ShaderPreprocessor* preprocessor = nullptr;
+  /* Injected after #version, for permutations of one source */
+  ShaderDefines defines;
+  /* Without wait the compile and link are only issued; call finish()
+     before using the shader */
+  bool wait = true;
+};
 
 class Shader {
  private:
   std::string name;
+  std::filesystem::path vertexPath;
+  std::filesystem::path fragmentPath;
+  ShaderDefines defines;
+  /* Files each stage was expanded from, to map error logs back */
+  std::vector<std::filesystem::path> vertexFiles;
+  std::vector<std::filesystem::path> fragmentFiles;
+  /* Set from an unwaited constructor until finish() */
+  GLuint pendingVertex;
+  GLuint pendingFragment;
+  ProgramCache* pendingCache;
+  uint64_t cacheKey;
+  /* Uniform locations of the current program, cleared when it's swapped */
+  mutable std::unordered_map<std::string, GLint> uniformLocations;
+  /* Binding assigned to each queried block, GL_INVALID_INDEX if absent */
+  std::unordered_map<std::string, GLuint> uniformBlockBindings;
+
+  GLint getUniformLocation(const std::string& name) const;
 
  public:
   GLint id;
 
-  Shader(const std::string& vertexPath, const std::string& fragmentPath);
+  /* With a cache, a binary of the same sources from an earlier run is
+     loaded instead of compiling, and fresh compiles are stored in it */
+  Shader(const std::filesystem::path& vertexPath,
+         const std::filesystem::path& fragmentPath,
+         const ShaderOptions& options = {});
+
+  /* Whether finish() would return without waiting on the driver. Always
+     true without KHR_parallel_shader_compile. */
+  bool isReady() const;
+  bool isPending() const { return pendingVertex != 0; }
+  /* Checks the compile and link results of an unwaited constructor,
+     throwing ShaderCompilationException on failure */
+  void finish();
   void use();
   void setUniform(const std::string& name, int val);
   void setUniform(const std::string& name, float val);
   void setUniform(const std::string& name, const glm::mat4& mat4);
+  void setUniform(const std::string& name, const glm::vec2& vec2);
   void setUniform(const std::string& name, const glm::vec3& vec3);
+  void setUniform(const std::string& name, const glm::vec4& vec4);
   bool hasUniform(const std::string& name) const;
+  /* Points the named uniform block at binding (GLSL 330 has no layout
+     binding). Returns false if the program has no such block. Only the
+     first call per program touches GL. */
+  bool bindUniformBlock(const std::string& name, GLuint binding);
 
   const std::string& getName() const { return name; }
   void setName(const std::string& n) { name = n; }
 
+  const std::filesystem::path& getVertexPath() const { return vertexPath; }
+  const std::filesystem::path& getFragmentPath() const {
+    return fragmentPath;
+  }
+  const ShaderDefines& getDefines() const { return defines; }
+
+  /* Every file the program was built from, includes too */
+  std::vector<std::filesystem::path> getSourceFiles() const;
+
+  /* Takes over the program of a finished rebuild of this shader, which
+     gets the old one. Materials keep pointing at this object. */
+  void swapProgram(Shader& rebuilt);
+
   ~Shader();
 };
 
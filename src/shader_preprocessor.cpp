@@ -0,0 +1,215 @@
+#include "src/shader_preprocessor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+#include "src/exceptions.h"
+#include "src/logger.h"
+
+/* Splits "  #  include "x"" into name "include" and the text after it.
+   Only lines starting with # are directives, so commented-out includes
+   stay comments. */
+static bool parseDirective(const std::string& line, std::string& name,
+                           std::string& rest) {
+  size_t pos = line.find_first_not_of(" \t");
+  if (pos == std::string::npos || line[pos] != '#') {
+    return false;
+  }
+  pos = line.find_first_not_of(" \t", pos + 1);
+  if (pos == std::string::npos) {
+    return false;
+  }
+  size_t end = pos;
+  while (end < line.size() &&
+         (std::isalnum(static_cast<unsigned char>(line[end])) ||
+          line[end] == '_')) {
+    end++;
+  }
+  name = line.substr(pos, end - pos);
+  rest = line.substr(end);
+  return true;
+}
+
+static std::string trim(const std::string& text) {
+  size_t start = text.find_first_not_of(" \t");
+  if (start == std::string::npos) {
+    return "";
+  }
+  size_t end = text.find_last_not_of(" \t");
+  return text.substr(start, end - start + 1);
+}
+
+static std::string lineDirective(size_t line, size_t fileIndex) {
+  return "#line " + std::to_string(line) + " " + std::to_string(fileIndex) +
+         "\n";
+}
+
+std::string describeDefines(const ShaderDefines& defines) {
+  std::string description;
+  for (const auto& [name, value] : defines) {
+    if (!description.empty()) {
+      description += ",";
+    }
+    description += value.empty() ? name : name + "=" + value;
+  }
+  return description;
+}
+
+const ShaderPreprocessor::SourceFile& ShaderPreprocessor::read(
+    const std::filesystem::path& path) {
+  auto it = cache.find(path.string());
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  LOG_INFO("Opening shader ", path);
+  std::ifstream sourceFile(path);
+  if (!sourceFile) {
+    LOG_ERROR("Cannot open shader under ", path);
+    throw FileNotFoundException("Cannot open shader " + path.string());
+  }
+
+  SourceFile file{{}, false};
+  std::string line;
+  std::string name;
+  std::string rest;
+  while (std::getline(sourceFile, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (parseDirective(line, name, rest) && name == "pragma" &&
+        trim(rest) == "once") {
+      file.pragmaOnce = true;
+    }
+    file.lines.push_back(std::move(line));
+  }
+  return cache.emplace(path.string(), std::move(file)).first->second;
+}
+
+void ShaderPreprocessor::expand(const std::filesystem::path& path,
+                                const ShaderDefines& defines,
+                                std::vector<std::filesystem::path>& stack,
+                                PreprocessedShader& result) {
+  if (std::find(stack.begin(), stack.end(), path) != stack.end()) {
+    std::string chain;
+    for (const std::filesystem::path& file : stack) {
+      chain += file.string() + " -> ";
+    }
+    LOG_ERROR("Shader include cycle: ", chain, path.string());
+    throw ShaderCompilationException("Shader include cycle: " + chain +
+                                     path.string());
+  }
+
+  const SourceFile& file = read(path);
+  auto known = std::find(result.files.begin(), result.files.end(), path);
+  size_t fileIndex = known - result.files.begin();
+  if (known == result.files.end()) {
+    result.files.push_back(path);
+  } else if (file.pragmaOnce) {
+    return;
+  }
+
+  bool root = stack.empty();
+  std::string& out = result.source;
+  std::string name;
+  std::string rest;
+
+  /* Defines go right after #version, which must stay the first line */
+  bool hasVersion =
+      root && std::any_of(file.lines.begin(), file.lines.end(),
+                          [&](const std::string& line) {
+                            return parseDirective(line, name, rest) &&
+                                   name == "version";
+                          });
+  auto emitDefines = [&](size_t nextLine) {
+    for (const auto& [define, value] : defines) {
+      out += "#define " + define + (value.empty() ? "" : " " + value) + "\n";
+    }
+    out += lineDirective(nextLine, fileIndex);
+  };
+  if (root && !hasVersion) {
+    emitDefines(1);
+  } else if (!root) {
+    out += lineDirective(1, fileIndex);
+  }
+
+  stack.push_back(path);
+  for (size_t i = 0; i < file.lines.size(); i++) {
+    const std::string& line = file.lines[i];
+    size_t lineNumber = i + 1;
+    if (!parseDirective(line, name, rest)) {
+      out += line;
+      out += '\n';
+      continue;
+    }
+
+    if (name == "include") {
+      size_t start = rest.find('"');
+      size_t end =
+          start == std::string::npos ? start : rest.find('"', start + 1);
+      if (end == std::string::npos) {
+        std::string message = path.string() + ":" +
+                              std::to_string(lineNumber) +
+                              ": malformed #include";
+        LOG_ERROR(message);
+        throw ShaderCompilationException(message);
+      }
+      std::filesystem::path includePath =
+          (path.parent_path() / rest.substr(start + 1, end - start - 1))
+              .lexically_normal();
+      expand(includePath, defines, stack, result);
+      out += lineDirective(lineNumber + 1, fileIndex);
+    } else if (name == "pragma" && trim(rest) == "once") {
+      out += '\n';
+    } else if (root && name == "version") {
+      out += line;
+      out += '\n';
+      emitDefines(lineNumber + 1);
+    } else {
+      out += line;
+      out += '\n';
+    }
+  }
+  stack.pop_back();
+}
+
+PreprocessedShader ShaderPreprocessor::process(
+    const std::filesystem::path& path, const ShaderDefines& defines) {
+  PreprocessedShader result;
+  std::vector<std::filesystem::path> stack;
+  expand(path.lexically_normal(), defines, stack, result);
+  return result;
+}
+
+void ShaderPreprocessor::invalidate(const std::filesystem::path& path) {
+  cache.erase(path.lexically_normal().string());
+}
+
+std::string ShaderPreprocessor::mapErrorLog(
+    const std::string& log, const std::vector<std::filesystem::path>& files) {
+  /* NVIDIA "0(12) :", Mesa "0:12(5):", AMD "ERROR: 0:12:" */
+  static const std::regex location(
+      R"(^((?:ERROR|WARNING): )?(\d+)(?:\((\d+)\)|:(\d+)(?:\(\d+\))?))");
+
+  std::istringstream lines(log);
+  std::string mapped;
+  std::string line;
+  std::smatch match;
+  while (std::getline(lines, line)) {
+    if (std::regex_search(line, match, location)) {
+      size_t fileIndex = std::stoul(match[2].str());
+      if (fileIndex < files.size()) {
+        std::string lineNumber =
+            match[3].matched ? match[3].str() : match[4].str();
+        line = match[1].str() + files[fileIndex].string() + ":" + lineNumber +
+               match.suffix().str();
+      }
+    }
+    mapped += line;
+    mapped += '\n';
+  }
+  return mapped;
+}
@@ -0,0 +1,56 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Macros injected after #version, name to value (empty for a bare flag).
+   Ordered, so equal sets compare and print the same. */
+using ShaderDefines = std::map<std::string, std::string>;
+
+struct PreprocessedShader {
+  std::string source;
+  /* Every file the source was built from, root first. A file's index is
+     the source string number its #line directives carry. */
+  std::vector<std::filesystem::path> files;
+};
+
+/* Expands #include "file" directives, resolved against the including
+   file. Files read once stay cached until invalidated. Files with
+   #pragma once are expanded once per shader, and include cycles throw
+   ShaderCompilationException. */
+class ShaderPreprocessor {
+ private:
+  struct SourceFile {
+    std::vector<std::string> lines;
+    bool pragmaOnce;
+  };
+
+  std::unordered_map<std::string, SourceFile> cache;
+
+  const SourceFile& read(const std::filesystem::path& path);
+  void expand(const std::filesystem::path& path, const ShaderDefines& defines,
+              std::vector<std::filesystem::path>& stack,
+              PreprocessedShader& result);
+
+ public:
+  PreprocessedShader process(const std::filesystem::path& path,
+                             const ShaderDefines& defines = {});
+
+  /* Drops a file from the cache so the next process() rereads it */
+  void invalidate(const std::filesystem::path& path);
+  void clear() { cache.clear(); }
+
+  /* Rewrites the "0(12)" and "0:12(3)" locations drivers report into
+     "path:12", using the file table of the shader the log belongs to */
+  static std::string mapErrorLog(
+      const std::string& log, const std::vector<std::filesystem::path>& files);
+};
+
+/* "A=1,B" style summary of a define set, for logs and keys */
+std::string describeDefines(const ShaderDefines& defines);
+
+#endif /* SHADER_PREPROCESSOR_H */
@@ -0,0 +1,99 @@
+#include "src/shadow_atlas.h"
+
+#include <stdexcept>
+
+#include "src/logger.h"
+#include "src/utils.h"
+
+ShadowAtlas::ShadowAtlas(int size, int minTileSize)
+    : size(size),
+      minTileSize(minTileSize),
+      cellsPerSide(size / minTileSize),
+      cells(cellsPerSide * cellsPerSide, false),
+      texture(0),
+      framebuffer(0) {
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  /* Hardware 2x2 PCF through sampler2DShadow */
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         texture, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    LOG_ERROR("Shadow atlas framebuffer is incomplete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    throw std::runtime_error("Shadow atlas framebuffer is incomplete");
+  }
+
+  glClear(GL_DEPTH_BUFFER_BIT);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  checkGLError("after creating shadow atlas");
+  LOG_INFO("Created ", size, "x", size, " shadow atlas");
+}
+
+ShadowAtlas::~ShadowAtlas() {
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteTextures(1, &texture);
+}
+
+bool ShadowAtlas::isFree(int cellX, int cellY, int cellCount) const {
+  for (int y = cellY; y < cellY + cellCount; y++) {
+    for (int x = cellX; x < cellX + cellCount; x++) {
+      if (cells[y * cellsPerSide + x]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ShadowAtlas::mark(const Tile& tile, bool used) {
+  int cellX = tile.x / minTileSize;
+  int cellY = tile.y / minTileSize;
+  int cellCount = tile.size / minTileSize;
+  for (int y = cellY; y < cellY + cellCount; y++) {
+    for (int x = cellX; x < cellX + cellCount; x++) {
+      cells[y * cellsPerSide + x] = used;
+    }
+  }
+}
+
+std::optional<ShadowAtlas::Tile> ShadowAtlas::allocate(int tileSize) {
+  int cellCount = 1;
+  while (cellCount * minTileSize < tileSize) {
+    cellCount *= 2;
+  }
+  if (cellCount > cellsPerSide) {
+    return std::nullopt;
+  }
+
+  for (int y = 0; y < cellsPerSide; y += cellCount) {
+    for (int x = 0; x < cellsPerSide; x += cellCount) {
+      if (isFree(x, y, cellCount)) {
+        Tile tile{x * minTileSize, y * minTileSize, cellCount * minTileSize};
+        mark(tile, true);
+        return tile;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+void ShadowAtlas::release(const Tile& tile) {
+  mark(tile, false);
+}
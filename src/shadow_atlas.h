@@ -0,0 +1,48 @@
+#ifndef SHADOW_ATLAS_H
+#define SHADOW_ATLAS_H
+
+#include <optional>
+#include <vector>
+
+#include <GL/glew.h>
+
+/* A single depth texture shared by all shadow maps. Tiles are power-of-two
+   squares aligned to their own size, which keeps fragmentation low and the
+   memory use fixed no matter how many lights cast shadows. */
+class ShadowAtlas {
+ public:
+  struct Tile {
+    int x, y;
+    int size;
+  };
+
+ private:
+  int size;
+  int minTileSize;
+  int cellsPerSide;
+  /* Occupancy of minTileSize cells, row-major */
+  std::vector<bool> cells;
+
+  GLuint texture;
+  GLuint framebuffer;
+
+  bool isFree(int cellX, int cellY, int cellCount) const;
+  void mark(const Tile& tile, bool used);
+
+ public:
+  ShadowAtlas(int size, int minTileSize);
+  ~ShadowAtlas();
+
+  ShadowAtlas(const ShadowAtlas&) = delete;
+  ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+  /* Size is rounded up to a power of two multiple of minTileSize */
+  std::optional<Tile> allocate(int tileSize);
+  void release(const Tile& tile);
+
+  int getSize() const { return size; }
+  GLuint getTexture() const { return texture; }
+  GLuint getFramebuffer() const { return framebuffer; }
+};
+
+#endif /* SHADOW_ATLAS_H */
@@ -0,0 +1,349 @@
+#include "src/shadow_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "src/directional_light_component.h"
+#include "src/game_object.h"
+#include "src/logger.h"
+#include "src/material.h"
+#include "src/spotlight_component.h"
+#include "src/utils.h"
+
+/* Extra depth behind a cascade so casters outside the view still occlude */
+static constexpr float CASTER_MARGIN = 50.0F;
+/* Weight of the logarithmic split scheme against the uniform one */
+static constexpr float CASCADE_SPLIT_LAMBDA = 0.75F;
+static constexpr float SPOT_SHADOW_NEAR = 0.05F;
+static constexpr float SPOT_SHADOW_MAX_RANGE = 100.0F;
+
+static uint64_t mixStamp(uint64_t id, uint64_t version) {
+  /* splitmix64 finalizer */
+  uint64_t x = id * 0x9E3779B97F4A7C15ULL + version;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+/* Whether the sphere touches the clip volume of matrix, tested against
+   the planes extracted from it */
+static bool sphereInFrustum(const glm::mat4& matrix, const glm::vec3& center,
+                            float radius) {
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i],
+                        matrix[3][i]);
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    for (float sign : {1.0F, -1.0F}) {
+      glm::vec4 plane = rows[3] + sign * rows[axis];
+      float length = glm::length(glm::vec3(plane));
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * length) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static glm::vec3 upFor(const glm::vec3& direction) {
+  return std::abs(direction.y) > 0.99F ? glm::vec3(0.0F, 0.0F, 1.0F)
+                                       : glm::vec3(0.0F, 1.0F, 0.0F);
+}
+
+ShadowRenderer::ShadowRenderer()
+    : cascadeSplits(0.0F), renderedViews(0) {
+  for (glm::mat4& matrix : dirShadowMatrices) {
+    matrix = glm::mat4(1.0F);
+  }
+  for (glm::mat4& matrix : spotShadowMatrices) {
+    matrix = glm::mat4(1.0F);
+  }
+}
+
+void ShadowRenderer::ensureAtlas() {
+  if (!atlas) {
+    atlas = std::make_unique<ShadowAtlas>(ATLAS_SIZE, MIN_TILE_SIZE);
+  }
+}
+
+void ShadowRenderer::gatherCasters(const RenderQueue& queue) {
+  casters.clear();
+  for (const auto& [key, group] : queue) {
+    if (key.first != OPAQUE_PRIORITY) {
+      continue;
+    }
+    for (GameObject* obj : group) {
+      if (!obj->getMesh() || !obj->getCastShadows()) {
+        continue;
+      }
+      Caster caster;
+      caster.object = obj;
+      obj->getWorldBoundingSphere(caster.center, caster.radius);
+      /* A LOD switch changes the silhouette just like a transform does */
+      caster.stamp = mixStamp(obj->getId(), obj->getTransformVersion()) ^
+                     mixStamp(obj->getId(), obj->getLodLevel() + 1);
+      casters.push_back(caster);
+    }
+  }
+}
+
+ShadowRenderer::LightShadows* ShadowRenderer::acquire(
+    const LightComponent* light, int viewCount, int tileSize) {
+  auto it = lights.find(light);
+  if (it != lights.end()) {
+    it->second.used = true;
+    return &it->second;
+  }
+
+  LightShadows shadows;
+  shadows.used = true;
+  for (int i = 0; i < viewCount; i++) {
+    std::optional<ShadowAtlas::Tile> tile = atlas->allocate(tileSize);
+    if (!tile) {
+      LOG_WARNING("Shadow atlas is full, light gets no shadows");
+      for (ShadowView& view : shadows.views) {
+        atlas->release(view.tile);
+      }
+      return nullptr;
+    }
+    shadows.views.push_back({*tile, glm::mat4(1.0F), 0, false});
+  }
+  return &lights.emplace(light, std::move(shadows)).first->second;
+}
+
+void ShadowRenderer::releaseUnused() {
+  std::erase_if(lights, [this](const auto& entry) {
+    if (entry.second.used) {
+      return false;
+    }
+    for (const ShadowView& view : entry.second.views) {
+      atlas->release(view.tile);
+    }
+    return true;
+  });
+}
+
+glm::mat4 ShadowRenderer::atlasMatrix(const ShadowAtlas::Tile& tile) const {
+  /* Clip space [-1, 1] to the tile's texture coordinates, depth to [0, 1] */
+  float atlasSize = static_cast<float>(atlas->getSize());
+  float scale = tile.size / atlasSize * 0.5F;
+  glm::vec3 offset((tile.x + tile.size * 0.5F) / atlasSize,
+                   (tile.y + tile.size * 0.5F) / atlasSize, 0.5F);
+
+  glm::mat4 matrix = glm::translate(glm::mat4(1.0F), offset);
+  return glm::scale(matrix, glm::vec3(scale, scale, 0.5F));
+}
+
+bool ShadowRenderer::renderView(ShadowView& view,
+                                const glm::mat4& lightMatrix) {
+  /* Casters outside the view neither show up in the map nor invalidate
+     it when they move */
+  viewCasters.clear();
+  uint64_t stamp = 0;
+  for (const Caster& caster : casters) {
+    if (sphereInFrustum(lightMatrix, caster.center, caster.radius)) {
+      viewCasters.push_back(&caster);
+      /* Order independent, and adding or removing a caster changes it */
+      stamp ^= caster.stamp;
+    }
+  }
+
+  if (view.valid && view.lightMatrix == lightMatrix &&
+      view.casterStamp == stamp) {
+    return false;
+  }
+
+  view.lightMatrix = lightMatrix;
+  view.casterStamp = stamp;
+  view.valid = true;
+
+  const ShadowAtlas::Tile& tile = view.tile;
+  glViewport(tile.x, tile.y, tile.size, tile.size);
+  glScissor(tile.x, tile.y, tile.size, tile.size);
+  glClear(GL_DEPTH_BUFFER_BIT);
+
+  depthShader->setUniform("lightSpace", lightMatrix);
+  for (const Caster* caster : viewCasters) {
+    caster->object->drawDepth(depthShader.get());
+  }
+
+  renderedViews++;
+  return true;
+}
+
+bool ShadowRenderer::renderDirectional(const Camera& camera,
+                                       DirectionalLightComponent* light) {
+  LightShadows* shadows = acquire(light, NUM_CASCADES, CASCADE_TILE_SIZE);
+  if (!shadows) {
+    return false;
+  }
+
+  float nearPlane = camera.getNearPlane();
+  float farPlane = std::min(camera.getFarPlane(), SHADOW_DISTANCE);
+  float tanHalfFovY = std::tan(glm::radians(camera.getFov()) * 0.5F);
+  float tanHalfFovX = tanHalfFovY * camera.getAspectRatio();
+  glm::mat4 inverseView = glm::inverse(camera.getViewMatrix());
+
+  glm::vec3 direction = light->getDirection();
+  /* Rotation only, so the light space does not follow the camera and the
+     snapped matrices stay identical while the camera moves within a texel */
+  glm::mat4 lightRotation =
+      glm::lookAt(glm::vec3(0.0F), direction, upFor(direction));
+
+  float splitNear = nearPlane;
+  for (int c = 0; c < NUM_CASCADES; c++) {
+    float t = static_cast<float>(c + 1) / NUM_CASCADES;
+    float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+    float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+    float splitFar = CASCADE_SPLIT_LAMBDA * logSplit +
+                     (1.0F - CASCADE_SPLIT_LAMBDA) * uniformSplit;
+
+    glm::vec3 corners[8];
+    int n = 0;
+    for (float depth : {splitNear, splitFar}) {
+      for (float sy : {-1.0F, 1.0F}) {
+        for (float sx : {-1.0F, 1.0F}) {
+          glm::vec4 viewCorner(sx * tanHalfFovX * depth,
+                               sy * tanHalfFovY * depth, -depth, 1.0F);
+          corners[n++] = glm::vec3(inverseView * viewCorner);
+        }
+      }
+    }
+
+    glm::vec3 center(0.0F);
+    for (const glm::vec3& corner : corners) {
+      center += corner;
+    }
+    center = center / 8.0F;
+
+    float radius = 0.0F;
+    for (const glm::vec3& corner : corners) {
+      radius = std::max(radius, glm::length(corner - center));
+    }
+    /* Quantized so the projection size does not shimmer */
+    radius = std::ceil(radius * 16.0F) / 16.0F;
+
+    ShadowView& view = shadows->views[c];
+    glm::vec3 lightCenter =
+        glm::vec3(lightRotation * glm::vec4(center, 1.0F));
+    float texel = 2.0F * radius / view.tile.size;
+    lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+    lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+    glm::mat4 projection = glm::ortho(
+        lightCenter.x - radius, lightCenter.x + radius,
+        lightCenter.y - radius, lightCenter.y + radius,
+        -lightCenter.z - radius - CASTER_MARGIN, -lightCenter.z + radius);
+    glm::mat4 lightMatrix = projection * lightRotation;
+
+    renderView(view, lightMatrix);
+    dirShadowMatrices[c] = atlasMatrix(view.tile) * lightMatrix;
+    cascadeSplits[c] = splitFar;
+    splitNear = splitFar;
+  }
+  return true;
+}
+
+bool ShadowRenderer::renderSpot(SpotlightComponent* light, int index) {
+  LightShadows* shadows = acquire(light, 1, SPOT_TILE_SIZE);
+  if (!shadows) {
+    return false;
+  }
+
+  glm::vec3 position = light->getGameObject()->getWorldPosition();
+  glm::vec3 direction = light->getDirection();
+  float range = std::min(light->getRange(), SPOT_SHADOW_MAX_RANGE);
+  float fov = std::min(2.0F * std::acos(light->getOuterCutOff()) + 0.1F,
+                       glm::radians(170.0F));
+
+  glm::mat4 view =
+      glm::lookAt(position, position + direction, upFor(direction));
+  glm::mat4 projection =
+      glm::perspective(fov, 1.0F, SPOT_SHADOW_NEAR, range);
+  glm::mat4 lightMatrix = projection * view;
+
+  ShadowView& shadowView = shadows->views[0];
+  renderView(shadowView, lightMatrix);
+  spotShadowMatrices[index] = atlasMatrix(shadowView.tile) * lightMatrix;
+  return true;
+}
+
+void ShadowRenderer::render(
+    const Camera& camera, const RenderQueue& queue,
+    const std::vector<DirectionalLightComponent*>& dirLights,
+    const std::vector<SpotlightComponent*>& spotLights) {
+  ensureAtlas();
+  renderedViews = 0;
+
+  for (auto& [light, shadows] : lights) {
+    shadows.used = false;
+  }
+
+  if (!depthShader) {
+    for (DirectionalLightComponent* light : dirLights) {
+      light->setShadowIndex(-1);
+    }
+    for (SpotlightComponent* light : spotLights) {
+      light->setShadowIndex(-1);
+    }
+    releaseUnused();
+    return;
+  }
+
+  gatherCasters(queue);
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glBindFramebuffer(GL_FRAMEBUFFER, atlas->getFramebuffer());
+  glEnable(GL_SCISSOR_TEST);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(2.0F, 4.0F);
+  depthShader->use();
+
+  bool hasDirShadow = false;
+  for (DirectionalLightComponent* light : dirLights) {
+    bool shadowed = !hasDirShadow && light->getCastShadows() &&
+                    renderDirectional(camera, light);
+    light->setShadowIndex(shadowed ? 0 : -1);
+    hasDirShadow = hasDirShadow || shadowed;
+  }
+
+  int spotShadows = 0;
+  for (SpotlightComponent* light : spotLights) {
+    bool shadowed = spotShadows < MAX_SPOT_SHADOWS &&
+                    light->getCastShadows() && renderSpot(light, spotShadows);
+    light->setShadowIndex(shadowed ? spotShadows++ : -1);
+  }
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glDisable(GL_SCISSOR_TEST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  releaseUnused();
+
+  LOG_DEBUG("Rendered ", renderedViews, " shadow views");
+  checkGLError("after shadow pass");
+}
+
+void ShadowRenderer::bind(Shader* shader) {
+  ensureAtlas();
+
+  glActiveTexture(GL_TEXTURE0 + ATLAS_UNIT);
+  glBindTexture(GL_TEXTURE_2D, atlas->getTexture());
+  glActiveTexture(GL_TEXTURE0);
+
+  shader->setUniform("shadowAtlas", static_cast<int>(ATLAS_UNIT));
+  shader->setUniform("cascadeSplits", cascadeSplits);
+  for (int i = 0; i < NUM_CASCADES; i++) {
+    shader->setUniform("dirShadowMatrices[" + std::to_string(i) + "]",
+                       dirShadowMatrices[i]);
+  }
+  for (int i = 0; i < MAX_SPOT_SHADOWS; i++) {
+    shader->setUniform("spotShadowMatrices[" + std::to_string(i) + "]",
+                       spotShadowMatrices[i]);
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef SHADOW_RENDERER_H
+#define SHADOW_RENDERER_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "src/camera.h"
+#include "src/render_queue.h"
+#include "src/shader.h"
+#include "src/shadow_atlas.h"
+
+class LightComponent;
+class DirectionalLightComponent;
+class SpotlightComponent;
+
+/* Renders shadow maps for the first shadow-casting directional light
+   (cascaded) and up to MAX_SPOT_SHADOWS spotlights into a ShadowAtlas.
+   A map is only re-rendered when its light matrix or one of the casters
+   that can reach it changed since the last frame. */
+class ShadowRenderer {
+ public:
+  /* Keep in sync with shaders/light_incl.frag */
+  static constexpr int NUM_CASCADES = 3;
+  static constexpr int MAX_SPOT_SHADOWS = 4;
+
+  static constexpr int ATLAS_SIZE = 4096;
+  static constexpr int MIN_TILE_SIZE = 256;
+  static constexpr int CASCADE_TILE_SIZE = 1024;
+  static constexpr int SPOT_TILE_SIZE = 512;
+
+  /* Texture unit of the atlas, above the ones used by LightClusters */
+  static constexpr GLuint ATLAS_UNIT = 7;
+
+  /* Directional shadows cover the view frustum up to this depth */
+  static constexpr float SHADOW_DISTANCE = 60.0F;
+
+ private:
+  struct ShadowView {
+    ShadowAtlas::Tile tile;
+    glm::mat4 lightMatrix;
+    uint64_t casterStamp;
+    bool valid;
+  };
+
+  struct LightShadows {
+    std::vector<ShadowView> views;
+    bool used;
+  };
+
+  struct Caster {
+    GameObject* object;
+    glm::vec3 center;
+    float radius;
+    uint64_t stamp;
+  };
+
+  std::unique_ptr<ShadowAtlas> atlas;
+  std::shared_ptr<Shader> depthShader;
+  std::unordered_map<const LightComponent*, LightShadows> lights;
+  std::vector<Caster> casters;
+  /* Scratch list of the casters inside the view being rendered */
+  std::vector<const Caster*> viewCasters;
+
+  glm::mat4 dirShadowMatrices[NUM_CASCADES];
+  glm::vec3 cascadeSplits;
+  glm::mat4 spotShadowMatrices[MAX_SPOT_SHADOWS];
+
+  size_t renderedViews;
+
+  void ensureAtlas();
+  void gatherCasters(const RenderQueue& queue);
+  LightShadows* acquire(const LightComponent* light, int viewCount,
+                        int tileSize);
+  void releaseUnused();
+
+  /* Draws the casters inside the light matrix's frustum. Returns false if
+     the cached map could be reused, as neither the matrix nor those
+     casters changed. */
+  bool renderView(ShadowView& view, const glm::mat4& lightMatrix);
+
+  bool renderDirectional(const Camera& camera,
+                         DirectionalLightComponent* light);
+  bool renderSpot(SpotlightComponent* light, int index);
+
+  glm::mat4 atlasMatrix(const ShadowAtlas::Tile& tile) const;
+
+ public:
+  ShadowRenderer();
+
+  void setDepthShader(std::shared_ptr<Shader> shader) {
+    depthShader = std::move(shader);
+  }
+
+  void render(const Camera& camera, const RenderQueue& queue,
+              const std::vector<DirectionalLightComponent*>& dirLights,
+              const std::vector<SpotlightComponent*>& spotLights);
+
+  /* Binds the atlas and sets the shadow uniforms of a lit shader */
+  void bind(Shader* shader);
+
+  /* Shadow views re-rendered during the last render() call */
+  size_t getRenderedViewCount() const { return renderedViews; }
+};
+
+#endif /* SHADOW_RENDERER_H */
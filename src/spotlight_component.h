@@ -6,7 +6,7 @@
 #include "src/game_object.h"
 #include "src/light_component.h"
 
-class SpotlightComponent : public LightComponent {
+class SpotlightComponent final : public LightComponent {
  private:
   glm::vec3 direction;
   float cutOff;
@@ -14,6 +14,9 @@ class SpotlightComponent : public LightComponent {
   float constant;
   float linear;
   float quadratic;
+  bool castShadows;
+  /* Set by ShadowRenderer every frame, -1 if the light has no shadow map */
+  int shadowIndex;
 
   std::string getUniformArrayName() const override { return "spotLights"; }
 
@@ -24,13 +27,15 @@ class SpotlightComponent : public LightComponent {
                      glm::vec3 ambient = glm::vec3(0.1f),
                      glm::vec3 diffuse = glm::vec3(0.8f),
                      glm::vec3 specular = glm::vec3(1.0f))
-      : LightComponent(ambient, diffuse, specular),
+      : LightComponent(LightType::SPOT, ambient, diffuse, specular),
         direction(glm::normalize(direction)),
         cutOff(glm::cos(glm::radians(cutOff))),
         outerCutOff(glm::cos(glm::radians(outerCutOff))),
         constant(constant),
         linear(linear),
-        quadratic(quadratic) {}
+        quadratic(quadratic),
+        castShadows(true),
+        shadowIndex(-1) {}
 
   glm::vec3 getDirection() const {
     if (gameObject) {
@@ -61,6 +66,17 @@ class SpotlightComponent : public LightComponent {
     quadratic = q;
   }
 
+  bool getCastShadows() const { return castShadows; }
+  void setCastShadows(bool cast) { castShadows = cast; }
+
+  int getShadowIndex() const { return shadowIndex; }
+  void setShadowIndex(int idx) { shadowIndex = idx; }
+
+  /* Radius beyond which the light's contribution is negligible */
+  float getRange() const {
+    return attenuationRange(constant, linear, quadratic);
+  }
+
   std::string getTypeName() const override { return "SpotlightComponent"; }
 
   void setUniforms(Shader* shader, int idx) override {
@@ -78,6 +94,7 @@ class SpotlightComponent : public LightComponent {
     shader->setUniform(makeUniformName(idx, "ambient"), getAmbient());
     shader->setUniform(makeUniformName(idx, "diffuse"), getDiffuse());
     shader->setUniform(makeUniformName(idx, "specular"), getSpecular());
+    shader->setUniform(makeUniformName(idx, "shadowIndex"), shadowIndex);
   }
 };
 
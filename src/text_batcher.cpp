@@ -0,0 +1,147 @@
+#include "src/text_batcher.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "src/font_atlas.h"
+#include "src/logger.h"
+#include "src/text_mesh.h"
+#include "src/utils.h"
+
+const VertexLayout& TextBatchVertex::layout() {
+  static const VertexLayout vertexLayout = {
+      sizeof(TextBatchVertex),
+      {
+          {0, 3, GL_FLOAT, GL_FALSE, offsetof(TextBatchVertex, position)},
+          {1, 3, GL_FLOAT, GL_FALSE, offsetof(TextBatchVertex, normal)},
+          {2, 2, GL_FLOAT, GL_FALSE, offsetof(TextBatchVertex, texCoords)},
+          {3, 1, GL_FLOAT, GL_FALSE, offsetof(TextBatchVertex, textIndex)},
+      },
+  };
+  return vertexLayout;
+}
+
+TextBatcher::TextBatcher()
+    : initialized(false),
+      vertexArray(0),
+      vertexBuffer(0),
+      instanceBuffer(0),
+      instanceTexture(0),
+      vertexCapacity(0),
+      instanceCapacity(0) {}
+
+TextBatcher::~TextBatcher() {
+  if (!initialized) {
+    return;
+  }
+  deleteVertexArray(vertexArray);
+  glDeleteTextures(1, &instanceTexture);
+  GLuint buffers[2] = {vertexBuffer, instanceBuffer};
+  glDeleteBuffers(2, buffers);
+}
+
+void TextBatcher::initGL() {
+  glGenVertexArrays(1, &vertexArray);
+  glGenBuffers(1, &vertexBuffer);
+  glGenBuffers(1, &instanceBuffer);
+
+  bindVertexArray(vertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  TextBatchVertex::layout().enable();
+  bindVertexArray(0);
+
+  glGenTextures(1, &instanceTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+  checkGLError("after creating text batcher buffers");
+  initialized = true;
+}
+
+void TextBatcher::stream(GLenum target, GLuint buffer, size_t& capacity,
+                         const void* data, size_t bytes) {
+  glBindBuffer(target, buffer);
+  if (bytes > capacity) {
+    capacity = std::max(capacity * 2, bytes);
+    LOG_DEBUG("Text batch buffer grown to ", capacity, " bytes");
+  }
+  /* Same size, no data: the driver hands out fresh storage */
+  glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+  glBufferSubData(target, 0, bytes, data);
+  glBindBuffer(target, 0);
+}
+
+void TextBatcher::add(TextMesh& text, const glm::mat4& model,
+                      const glm::vec4& color) {
+  queued.push_back({&text, instances.size()});
+  instances.push_back({model, color});
+}
+
+void TextBatcher::flush(Shader* shader) {
+  if (queued.empty()) {
+    return;
+  }
+  if (!initialized) {
+    initGL();
+  }
+
+  auto runKey = [](const QueuedText& queuedText) {
+    return std::make_tuple(queuedText.text->getFont().get(),
+                           queuedText.text->isDepthMaskDisabled());
+  };
+  std::stable_sort(queued.begin(), queued.end(),
+                   [&runKey](const QueuedText& a, const QueuedText& b) {
+                     return runKey(a) < runKey(b);
+                   });
+
+  vertices.clear();
+  runs.clear();
+  for (const QueuedText& queuedText : queued) {
+    const auto [font, disableDepthMask] = runKey(queuedText);
+    if (runs.empty() || runs.back().font != font ||
+        runs.back().disableDepthMask != disableDepthMask) {
+      runs.push_back(
+          {font, disableDepthMask, static_cast<GLint>(vertices.size()), 0});
+    }
+
+    float textIndex = static_cast<float>(queuedText.instance);
+    for (const Vertex& glyph : queuedText.text->getGlyphVertices()) {
+      vertices.push_back(
+          {glyph.position, glyph.normal, glyph.texCoords, textIndex});
+    }
+    runs.back().count =
+        static_cast<GLsizei>(vertices.size()) - runs.back().first;
+  }
+
+  stream(GL_ARRAY_BUFFER, vertexBuffer, vertexCapacity, vertices.data(),
+         vertices.size() * sizeof(TextBatchVertex));
+  stream(GL_COPY_WRITE_BUFFER, instanceBuffer, instanceCapacity,
+         instances.data(), instances.size() * sizeof(TextInstance));
+
+  glActiveTexture(GL_TEXTURE0 + TEXT_DATA_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+  glActiveTexture(GL_TEXTURE0);
+  shader->setUniform("textData", static_cast<int>(TEXT_DATA_UNIT));
+
+  LOG_DEBUG("Drawing ", queued.size(), " texts in ", runs.size(),
+            " batches");
+  bindVertexArray(vertexArray);
+  for (const Run& run : runs) {
+    if (run.count == 0) {
+      continue;
+    }
+    run.font->bind(ATLAS_UNIT);
+    if (run.disableDepthMask) {
+      glDepthMask(GL_FALSE);
+    }
+    glDrawArrays(GL_TRIANGLES, run.first, run.count);
+    if (run.disableDepthMask) {
+      glDepthMask(GL_TRUE);
+    }
+  }
+  bindVertexArray(0);
+
+  queued.clear();
+  instances.clear();
+}
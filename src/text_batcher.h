@@ -0,0 +1,99 @@
+#ifndef TEXT_BATCHER_H
+#define TEXT_BATCHER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "src/shader.h"
+#include "src/vertex_layout.h"
+
+class FontAtlas;
+class TextMesh;
+
+/* Glyph vertex in the text's own space, tagged with the text it belongs
+   to. The index is a float so the stock VertexLayout can describe it;
+   floats hold integers exactly far beyond any realistic text count. */
+struct TextBatchVertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 texCoords;
+  float textIndex;
+
+  static const VertexLayout& layout();
+};
+
+/* Per-text data, read by shaders/text_data_incl.vert */
+struct TextInstance {
+  glm::mat4 model;
+  /* Final color, alpha multiplies the glyph coverage */
+  glm::vec4 color;
+};
+
+/* Collects the glyph quads of many texts and draws them with one
+   glDrawArrays per (font atlas, depth mask) run. Vertices and per-text
+   data are streamed into buffers that are orphaned on every flush, so the
+   driver never stalls on a draw still reading the previous contents. */
+class TextBatcher {
+ public:
+  static constexpr size_t TEXELS_PER_TEXT = sizeof(TextInstance) / 16;
+
+  /* Above IndirectRenderer::DRAW_DATA_UNIT */
+  static constexpr GLuint TEXT_DATA_UNIT = 9;
+  /* Unit the run's atlas is bound to; point the shader's sampler at it */
+  static constexpr GLuint ATLAS_UNIT = 0;
+
+ private:
+  struct QueuedText {
+    TextMesh* text;
+    size_t instance;
+  };
+
+  /* Glyphs drawn with one call */
+  struct Run {
+    const FontAtlas* font;
+    bool disableDepthMask;
+    GLint first;
+    GLsizei count;
+  };
+
+  bool initialized;
+  GLuint vertexArray;
+  GLuint vertexBuffer;
+  GLuint instanceBuffer;
+  GLuint instanceTexture;
+  size_t vertexCapacity;
+  size_t instanceCapacity;
+
+  std::vector<QueuedText> queued;
+  std::vector<TextInstance> instances;
+  std::vector<TextBatchVertex> vertices;
+  std::vector<Run> runs;
+
+  void initGL();
+  /* Orphans buffer, growing it to at least bytes first */
+  static void stream(GLenum target, GLuint buffer, size_t& capacity,
+                     const void* data, size_t bytes);
+
+ public:
+  TextBatcher();
+  ~TextBatcher();
+
+  TextBatcher(const TextBatcher&) = delete;
+  TextBatcher& operator=(const TextBatcher&) = delete;
+
+  /* Shaders opt in by including text_data_incl.vert */
+  static bool isBatchable(Shader* shader) {
+    return shader->hasUniform("textData");
+  }
+
+  /* Queues text for the next flush; it must outlive that flush */
+  void add(TextMesh& text, const glm::mat4& model, const glm::vec4& color);
+
+  /* Draws everything queued with an already bound, batchable shader */
+  void flush(Shader* shader);
+};
+
+#endif /* TEXT_BATCHER_H */
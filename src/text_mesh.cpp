@@ -9,16 +9,11 @@ TextMesh::TextMesh(std::shared_ptr<FontAtlas> font, const std::string& text,
       font(std::move(font)),
       text(text),
       needsRebuild(false),
+      needsUpload(true),
       disableDepthMask(disableDepthMask) {
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-
+  /* Mesh set up VAO with the Vertex layout over VBO; the glyphs are
+     uploaded into it on the first individual draw */
   buildVertices();
-
-  glBindVertexArray(VAO);
-  Vertex::enableVertexAttribArray();
-
-  glBindVertexArray(0);
 }
 
 void TextMesh::setText(const std::string& newTextMesh) {
@@ -71,12 +66,17 @@ void TextMesh::buildVertices() {
     /* So hacky... */
     z += 0.1;
   }
+  computeBounds();
+  verticesCount = vertices.size();
+  needsUpload = true;
+}
 
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
-               vertices.data(), GL_DYNAMIC_DRAW);
-  glBindVertexArray(0);
+const std::vector<Vertex>& TextMesh::getGlyphVertices() {
+  if (needsRebuild) {
+    buildVertices();
+    needsRebuild = false;
+  }
+  return vertices;
 }
 
 void TextMesh::draw() {
@@ -90,10 +90,17 @@ void TextMesh::draw() {
     buildVertices();
     needsRebuild = false;
   }
+  if (needsUpload) {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+                 vertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    needsUpload = false;
+  }
 
-  glBindVertexArray(VAO);
+  bindVertexArray(VAO);
   glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-  glBindVertexArray(0);
+  bindVertexArray(0);
 
   if (disableDepthMask) {
     glDepthMask(GL_TRUE);
@@ -18,6 +18,8 @@ class TextMesh : public Mesh {
   std::string text;
 
   bool needsRebuild;
+  /* Set when vertices changed since they were last put in VBO */
+  bool needsUpload;
   bool disableDepthMask;
 
   void buildVertices();
@@ -30,6 +32,12 @@ class TextMesh : public Mesh {
   void setFont(std::shared_ptr<FontAtlas> newFont);
 
   const std::string& getText() const { return text; }
+  const std::shared_ptr<FontAtlas>& getFont() const { return font; }
+  bool isDepthMaskDisabled() const { return disableDepthMask; }
+
+  /* Glyph quads in text space, rebuilt first if the text changed. Batched
+     texts are drawn from these and never touch their own VBO */
+  const std::vector<Vertex>& getGlyphVertices();
 
   void draw() override;
 };
@@ -1,5 +1,6 @@
 #include "src/texture.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -8,7 +9,17 @@
 #include "src/logger.h"
 #include "src/utils.h"
 
-Texture::Texture() : id(0), width(0), height(0), channels(0) {
+uint64_t Texture::currentFrame = 0;
+
+Texture::Texture(GLenum target)
+    : id(0),
+      target(target),
+      width(0),
+      height(0),
+      channels(0),
+      lastUsedFrame(currentFrame),
+      screenSizeFrame(0),
+      screenSize(0.0F) {
   glGenTextures(1, &id);
 }
 
@@ -16,12 +27,22 @@ void Texture::bind(unsigned int slot) const {
   LOG_DEBUG("Binding texture ", getName(), " under slot ", slot);
   glActiveTexture(GL_TEXTURE0 + slot);
   checkGLError("glactivate");
-  glBindTexture(GL_TEXTURE_2D, id);
+  glBindTexture(target, id);
   checkGLError("glbind");
+  lastUsedFrame = currentFrame;
+}
+
+void Texture::requestScreenSize(float pixels) const {
+  if (screenSizeFrame != currentFrame) {
+    screenSizeFrame = currentFrame;
+    screenSize = pixels;
+  } else {
+    screenSize = std::max(screenSize, pixels);
+  }
 }
 
 void Texture::unbind() const {
-  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindTexture(target, 0);
 }
 
 Texture::~Texture() {
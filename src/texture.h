@@ -1,21 +1,45 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 #include <stb_image.h>
 
+class TextureArray;
+
+/* Where a texture was copied to when ResourceManager packed it */
+struct TextureSlot {
+  std::shared_ptr<TextureArray> array;
+  int layer;
+  /* Part of the layer the texture covers: UV offset in xy, scale in zw */
+  glm::vec4 rect;
+};
+
 class Texture {
+ private:
+  static uint64_t currentFrame;
+
  protected:
   std::string name;
   GLuint id;
+  GLenum target;
   int width;
   int height;
   int channels;
+  std::optional<TextureSlot> slot;
+
+  /* Written by bind() and requestScreenSize(), read by TextureStreamer */
+  mutable uint64_t lastUsedFrame;
+  mutable uint64_t screenSizeFrame;
+  mutable float screenSize;
 
-  Texture();
+  explicit Texture(GLenum target = GL_TEXTURE_2D);
 
  public:
   virtual ~Texture();
@@ -27,8 +51,26 @@ class Texture {
   void setName(const std::string& n) { name = n; }
 
   GLuint getId() const { return id; }
+  GLenum getTarget() const { return target; }
   int getWidth() const { return width; }
   int getHeight() const { return height; }
   int getChannels() const { return channels; }
+
+  /* Null unless the texture has been packed into a TextureArray */
+  const TextureSlot* getSlot() const { return slot ? &*slot : nullptr; }
+  void setSlot(TextureSlot newSlot) { slot = std::move(newSlot); }
+
+  /* Frame counter bind() stamps textures with, advanced once per frame */
+  static uint64_t getCurrentFrame() { return currentFrame; }
+  static void advanceFrame() { currentFrame++; }
+
+  uint64_t getLastUsedFrame() const { return lastUsedFrame; }
+
+  /* Records that the texture covers about pixels on screen this frame.
+     The largest request of a frame wins. */
+  void requestScreenSize(float pixels) const;
+  /* Largest size requested during the last frame that made a request, 0
+     if there never was one */
+  float getRequestedScreenSize() const { return screenSize; }
 };
 #endif /* TEXTURE_H */
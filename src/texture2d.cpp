@@ -1,48 +1,236 @@
 #include "src/texture2d.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
 #include "src/logger.h"
 #include "src/utils.h"
 
+static constexpr unsigned char PLACEHOLDER_TEXEL[4] = {128, 128, 128, 255};
+
+static GLenum channelsFormat(int channels) {
+  if (channels == 1) {
+    return GL_RED;
+  } else if (channels == 3) {
+    return GL_RGB;
+  } else if (channels == 4) {
+    return GL_RGBA;
+  }
+  LOG_WARNING("Texture with weird channel count: ", channels);
+  return GL_RGB;
+}
+
+static bool usesMipmaps(GLint minFilter) {
+  return minFilter != GL_NEAREST && minFilter != GL_LINEAR;
+}
+
+/* Drivers pad RGB textures to four bytes per texel */
+static size_t gpuLevelBytes(int width, int height, int channels) {
+  int texelBytes = channels == 3 ? 4 : channels;
+  return static_cast<size_t>(width) * height * texelBytes;
+}
+
 Texture2D::Texture2D(const std::filesystem::path& texturePath)
     : Texture2D(texturePath, GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR,
                 GL_LINEAR) {}
 
 Texture2D::Texture2D(const std::filesystem::path& texturePath, GLint wrapS,
                      GLint wrapT, GLint minFilter, GLint magFilter)
-    : Texture() {
+    : Texture2D(wrapS, wrapT, minFilter, magFilter) {
   LOG_INFO("Loading texture from ", texturePath);
+  if (isTextureContainer(texturePath)) {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    CompressedTexture texture = readTextureContainer(texturePath, maxSize);
+    uploadCompressed(texture, texture.data.data());
+    return;
+  }
+
   stbi_set_flip_vertically_on_load(true);
 
-  unsigned char* data =
-      stbi_load(texturePath.c_str(), &width, &height, &channels, 0);
+  int imageWidth = 0;
+  int imageHeight = 0;
+  int imageChannels = 0;
+  unsigned char* data = stbi_load(texturePath.c_str(), &imageWidth,
+                                  &imageHeight, &imageChannels, 0);
 
   if (!data) {
     LOG_ERROR("Failed to load texture: ", texturePath);
     throw std::runtime_error("Failed to load texture: " + texturePath.string());
   }
 
-  GLenum format = GL_RGB;
-  if (channels == 1) {
-    format = GL_RED;
-  } else if (channels == 3) {
-    format = GL_RGB;
-  } else if (channels == 4) {
-    format = GL_RGBA;
-  } else {
-    LOG_WARNING("Texture with weird channel count: ", channels);
-  }
+  MipChain chain =
+      generateMipChain(data, imageWidth, imageHeight, imageChannels);
+  stbi_image_free(data);
+  uploadMipChain(chain, chain.data.data());
+}
+
+Texture2D::Texture2D()
+    : Texture2D(GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR) {}
 
+Texture2D::Texture2D(GLint wrapS, GLint wrapT, GLint minFilter,
+                     GLint magFilter)
+    : Texture(),
+      minFilter(minFilter),
+      loaded(false),
+      compressed(false),
+      levelCount(1),
+      residentLevel(0),
+      residentBytes(sizeof(PLACEHOLDER_TEXEL)) {
   glBindTexture(GL_TEXTURE_2D, id);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
-  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-               GL_UNSIGNED_BYTE, data);
-  glGenerateMipmap(GL_TEXTURE_2D);
+  /* A single level is mipmap complete, so the placeholder samples fine */
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               PLACEHOLDER_TEXEL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-  stbi_image_free(data);
+void Texture2D::releaseLevelsFrom(int newLevelCount) {
+  for (int level = newLevelCount; level < levelCount; level++) {
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, newLevelCount - 1);
+  levelCount = newLevelCount;
+}
+
+void Texture2D::uploadMipChain(const MipChain& chain, const void* data,
+                               int firstLevel) {
+  width = chain.levels[0].width;
+  height = chain.levels[0].height;
+  channels = chain.channels;
+  GLenum format = channelsFormat(channels);
+  int sourceLevels = static_cast<int>(chain.levels.size());
+  firstLevel = std::clamp(firstLevel, 0, sourceLevels - 1);
+  int newLevelCount = usesMipmaps(minFilter) ? sourceLevels - firstLevel : 1;
+
+  glBindTexture(GL_TEXTURE_2D, id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  residentBytes = 0;
+  for (int level = 0; level < newLevelCount; level++) {
+    const MipLevel& mip = chain.levels[firstLevel + level];
+    const void* levelData = reinterpret_cast<const void*>(
+        reinterpret_cast<uintptr_t>(data) + mip.offset);
+    glTexImage2D(GL_TEXTURE_2D, level, format, mip.width, mip.height, 0,
+                 format, GL_UNSIGNED_BYTE, levelData);
+    residentBytes += gpuLevelBytes(mip.width, mip.height, channels);
+  }
+  releaseLevelsFrom(newLevelCount);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  loaded = true;
+  compressed = false;
+  residentLevel = firstLevel;
+  /* A fresh upload counts as a use so the streamer doesn't evict it before
+     its first draw */
+  lastUsedFrame = getCurrentFrame();
+}
+
+void Texture2D::uploadCompressed(const CompressedTexture& texture,
+                                 const void* data, int firstLevel) {
+  width = texture.width;
+  height = texture.height;
+  channels = compressedChannels(texture.format);
+  bool native = isCompressionSupported(texture.format);
+  if (!native) {
+    LOG_WARNING("Compressed format unsupported, decoding texture '", name,
+                "' in software");
+  }
+
+  /* The cooked chain replaces glGenerateMipmap; without mipmapped filtering
+     only the base level is needed */
+  int sourceLevels = static_cast<int>(texture.levels.size());
+  firstLevel = std::clamp(firstLevel, 0, sourceLevels - 1);
+  int newLevelCount = usesMipmaps(minFilter) ? sourceLevels - firstLevel : 1;
+
+  glBindTexture(GL_TEXTURE_2D, id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  residentBytes = 0;
+  for (int level = 0; level < newLevelCount; level++) {
+    const CompressedMipLevel& mip = texture.levels[firstLevel + level];
+    if (native) {
+      const void* levelData = reinterpret_cast<const void*>(
+          reinterpret_cast<uintptr_t>(data) + mip.offset);
+      glCompressedTexImage2D(GL_TEXTURE_2D, level,
+                             compressedInternalFormat(texture.format),
+                             mip.width, mip.height, 0, mip.size, levelData);
+      residentBytes += mip.size;
+    } else {
+      std::vector<unsigned char> rgba =
+          decompressImage(static_cast<const std::byte*>(data) + mip.offset,
+                          mip.width, mip.height, texture.format);
+      glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+      residentBytes += gpuLevelBytes(mip.width, mip.height, 4);
+    }
+  }
+  releaseLevelsFrom(newLevelCount);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   glBindTexture(GL_TEXTURE_2D, 0);
+  loaded = true;
+  compressed = native;
+  residentLevel = firstLevel;
+  lastUsedFrame = getCurrentFrame();
+}
+
+void Texture2D::retainSource(MipChain chain) {
+  sourceCompressed.reset();
+  sourceMips = std::move(chain);
+}
+
+void Texture2D::retainSource(CompressedTexture texture) {
+  sourceMips.reset();
+  sourceCompressed = std::move(texture);
+}
+
+int Texture2D::getSourceLevelCount() const {
+  if (sourceMips) {
+    return static_cast<int>(sourceMips->levels.size());
+  } else if (sourceCompressed) {
+    return static_cast<int>(sourceCompressed->levels.size());
+  }
+  return 0;
+}
+
+size_t Texture2D::getResidentBytesFrom(int firstLevel) const {
+  int sourceLevels = getSourceLevelCount();
+  if (sourceLevels == 0) {
+    return residentBytes;
+  }
+  firstLevel = std::clamp(firstLevel, 0, sourceLevels - 1);
+  int lastLevel = usesMipmaps(minFilter) ? sourceLevels : firstLevel + 1;
+
+  size_t bytes = 0;
+  for (int level = firstLevel; level < lastLevel; level++) {
+    if (sourceMips) {
+      const MipLevel& mip = sourceMips->levels[level];
+      bytes += gpuLevelBytes(mip.width, mip.height, channels);
+    } else if (compressed) {
+      bytes += sourceCompressed->levels[level].size;
+    } else {
+      const CompressedMipLevel& mip = sourceCompressed->levels[level];
+      bytes += gpuLevelBytes(mip.width, mip.height, 4);
+    }
+  }
+  return bytes;
+}
+
+void Texture2D::setResidentLevel(int firstLevel) {
+  if (!isStreamable() || firstLevel == residentLevel) {
+    return;
+  }
+  /* Streaming is not a use, evicted textures must stay least recent */
+  uint64_t lastUsed = lastUsedFrame;
+  if (sourceMips) {
+    uploadMipChain(*sourceMips, sourceMips->data.data(), firstLevel);
+  } else {
+    uploadCompressed(*sourceCompressed, sourceCompressed->data.data(),
+                     firstLevel);
+  }
+  lastUsedFrame = lastUsed;
 }
@@ -1,16 +1,80 @@
 #ifndef TEXTURE2D_H
 #define TEXTURE2D_H
 
+#include <optional>
+
 #include <GL/glew.h>
 
+#include "src/mipmap_generator.h"
 #include "src/texture.h"
+#include "src/texture_container.h"
 
 class Texture2D : public Texture {
+ private:
+  GLint minFilter;
+  bool loaded;
+  bool compressed;
+  int levelCount;
+  /* First level of the full chain that is on the GPU, as GL level 0 */
+  int residentLevel;
+  size_t residentBytes;
+
+  /* CPU copy of the full chain that lower levels are streamed back in from,
+     kept only for textures handed to retainSource() */
+  std::optional<MipChain> sourceMips;
+  std::optional<CompressedTexture> sourceCompressed;
+
+  /* Respecifies levels past the new chain as empty so their memory is
+     released and drops MAX_LEVEL to the last uploaded level */
+  void releaseLevelsFrom(int newLevelCount);
+
  public:
+  /* Paths ending in .ctex are loaded as cooked, block-compressed textures.
+     Other images are treated as sRGB color when building mipmaps. */
   explicit Texture2D(const std::filesystem::path& texturePath);
 
   Texture2D(const std::filesystem::path& texturePath, GLint wrapS, GLint wrapT,
             GLint minFilter, GLint magFilter);
+
+  /* Creates the texture holding a 1x1 placeholder until an upload */
+  Texture2D();
+
+  Texture2D(GLint wrapS, GLint wrapT, GLint minFilter, GLint magFilter);
+
+  /* Replaces the image with a CPU-generated mip chain. data points at
+     chain.data or is an offset into the bound GL_PIXEL_UNPACK_BUFFER. */
+  void uploadMipChain(const MipChain& chain, const void* data,
+                      int firstLevel = 0);
+
+  /* Uploads every level of a cooked texture with glCompressedTexImage2D.
+     data points at texture.data or is an offset into the bound
+     GL_PIXEL_UNPACK_BUFFER. Formats the GPU lacks are decoded in software,
+     which needs data to be a CPU pointer. */
+  void uploadCompressed(const CompressedTexture& texture, const void* data,
+                        int firstLevel = 0);
+
+  /* Keeps the uploaded chain in memory so setResidentLevel() can drop and
+     restore its largest levels */
+  void retainSource(MipChain chain);
+  void retainSource(CompressedTexture texture);
+  bool isStreamable() const { return sourceMips || sourceCompressed; }
+
+  /* Levels in the retained chain, 0 when not streamable */
+  int getSourceLevelCount() const;
+  /* GPU bytes the texture would take with levels from firstLevel resident */
+  size_t getResidentBytesFrom(int firstLevel) const;
+
+  /* Re-uploads the retained chain from firstLevel down, freeing or
+     restoring the levels above it. Width and height keep describing the
+     full image. */
+  void setResidentLevel(int firstLevel);
+  int getResidentLevel() const { return residentLevel; }
+  size_t getResidentBytes() const { return residentBytes; }
+
+  bool isLoaded() const { return loaded; }
+  bool isCompressed() const { return compressed; }
+  /* Mip levels holding image data */
+  int getLevelCount() const { return levelCount; }
 };
 
 #endif /* TEXTURE2D_H */
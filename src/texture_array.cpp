@@ -0,0 +1,84 @@
+#include "src/texture_array.h"
+
+#include <algorithm>
+
+#include "src/logger.h"
+
+TextureArray::TextureArray(int tileWidth, int tileHeight, int columns,
+                           int rows, int layers, int levelCount)
+    : Texture(GL_TEXTURE_2D_ARRAY),
+      tileWidth(tileWidth),
+      tileHeight(tileHeight),
+      columns(columns),
+      rows(rows),
+      layers(layers),
+      levelCount(levelCount) {
+  width = tileWidth * columns;
+  height = tileHeight * rows;
+  channels = 4;
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+  /* Shaders wrap inside the tile; clamping keeps the filter off the other
+     edge of the layer */
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                  levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+  for (int level = 0; level < levelCount; level++) {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8,
+                 std::max(1, width >> level), std::max(1, height >> level),
+                 layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+size_t TextureArray::getBytes() const {
+  size_t bytes = 0;
+  for (int level = 0; level < levelCount; level++) {
+    bytes += static_cast<size_t>(std::max(1, width >> level)) *
+             std::max(1, height >> level) * layers * 4;
+  }
+  return bytes;
+}
+
+glm::vec4 TextureArray::rectOf(int tile) const {
+  int cell = tile % (columns * rows);
+  int column = cell % columns;
+  int row = cell / columns;
+  return glm::vec4(static_cast<float>(column) / columns,
+                   static_cast<float>(row) / rows, 1.0F / columns,
+                   1.0F / rows);
+}
+
+bool TextureArray::copyTile(int tile, GLuint sourceTexture,
+                            GLuint framebuffer) {
+  int cell = tile % (columns * rows);
+  int x = (cell % columns) * tileWidth;
+  int y = (cell / columns) * tileHeight;
+  int layer = layerOf(tile);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+  bool copied = true;
+  for (int level = 0; level < levelCount; level++) {
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, sourceTexture, level);
+    if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE) {
+      LOG_WARNING("Cannot read texture ", sourceTexture, " level ", level,
+                  " for packing");
+      copied = false;
+      break;
+    }
+    glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x >> level, y >> level,
+                        layer, 0, 0, std::max(1, tileWidth >> level),
+                        std::max(1, tileHeight >> level));
+  }
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         GL_TEXTURE_2D, 0, 0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  return copied;
+}
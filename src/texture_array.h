@@ -0,0 +1,44 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "src/texture.h"
+
+/* GL_TEXTURE_2D_ARRAY of RGBA8 layers, each split into a grid of equally
+   sized tiles. A grid of 1x1 is a plain texture array; larger grids make
+   every layer an atlas. Shaders sample it through a TextureSlot's layer and
+   rect and wrap UVs themselves, see shaders/light_clustered_layered.frag. */
+class TextureArray : public Texture {
+ private:
+  int tileWidth;
+  int tileHeight;
+  int columns;
+  int rows;
+  int layers;
+  int levelCount;
+
+ public:
+  TextureArray(int tileWidth, int tileHeight, int columns, int rows,
+               int layers, int levelCount);
+
+  int getTileWidth() const { return tileWidth; }
+  int getTileHeight() const { return tileHeight; }
+  int getLayerCount() const { return layers; }
+  int getCapacity() const { return columns * rows * layers; }
+  /* GPU bytes of every level and layer */
+  size_t getBytes() const;
+
+  int layerOf(int tile) const { return tile / (columns * rows); }
+  glm::vec4 rectOf(int tile) const;
+
+  /* Copies the first getLevelCount() levels of a 2D texture into a tile on
+     the GPU, reading through framebuffer. Returns false if the source
+     can't be attached for reading. */
+  bool copyTile(int tile, GLuint sourceTexture, GLuint framebuffer);
+};
+
+#endif /* TEXTURE_ARRAY_H */
@@ -0,0 +1,404 @@
+#include "src/texture_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+static constexpr int BLOCK_DIM = 4;
+static constexpr int BLOCK_TEXELS = BLOCK_DIM * BLOCK_DIM;
+
+size_t compressedBlockSize(TextureCompression format) {
+  switch (format) {
+    case TextureCompression::BC1:
+    case TextureCompression::BC4:
+      return 8;
+    case TextureCompression::BC3:
+    case TextureCompression::BC5:
+      return 16;
+  }
+  return 16;
+}
+
+size_t compressedImageSize(TextureCompression format, int width, int height) {
+  size_t blocksX = std::max(1, (width + BLOCK_DIM - 1) / BLOCK_DIM);
+  size_t blocksY = std::max(1, (height + BLOCK_DIM - 1) / BLOCK_DIM);
+  return blocksX * blocksY * compressedBlockSize(format);
+}
+
+int compressedChannels(TextureCompression format) {
+  switch (format) {
+    case TextureCompression::BC1:
+      return 3;
+    case TextureCompression::BC3:
+      return 4;
+    case TextureCompression::BC4:
+      return 1;
+    case TextureCompression::BC5:
+      return 2;
+  }
+  return 4;
+}
+
+GLenum compressedInternalFormat(TextureCompression format) {
+  switch (format) {
+    case TextureCompression::BC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureCompression::BC3:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureCompression::BC4:
+      return GL_COMPRESSED_RED_RGTC1;
+    case TextureCompression::BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+  }
+  return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+bool isCompressionSupported(TextureCompression format) {
+  if (format == TextureCompression::BC1 || format == TextureCompression::BC3) {
+    return GLEW_EXT_texture_compression_s3tc;
+  }
+  return true;
+}
+
+TextureCompression defaultCompression(int channels) {
+  if (channels == 1) {
+    return TextureCompression::BC4;
+  } else if (channels == 2) {
+    return TextureCompression::BC5;
+  } else if (channels == 3) {
+    return TextureCompression::BC1;
+  }
+  return TextureCompression::BC3;
+}
+
+/* Copies the 4x4 block at (blockX, blockY) into 16 RGBA texels, clamping
+   reads past the image edge */
+static void fetchBlock(const unsigned char* rgba, int width, int height,
+                       int blockX, int blockY,
+                       unsigned char block[BLOCK_TEXELS][4]) {
+  for (int y = 0; y < BLOCK_DIM; y++) {
+    int sourceY = std::min(blockY * BLOCK_DIM + y, height - 1);
+    for (int x = 0; x < BLOCK_DIM; x++) {
+      int sourceX = std::min(blockX * BLOCK_DIM + x, width - 1);
+      const unsigned char* texel =
+          rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4;
+      std::memcpy(block[y * BLOCK_DIM + x], texel, 4);
+    }
+  }
+}
+
+static uint16_t packRgb565(const float color[3]) {
+  int r = std::clamp(static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)),
+                     0, 31);
+  int g = std::clamp(static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)),
+                     0, 63);
+  int b = std::clamp(static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)),
+                     0, 31);
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t color, int out[3]) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  out[0] = (r << 3) | (r >> 2);
+  out[1] = (g << 2) | (g >> 4);
+  out[2] = (b << 3) | (b >> 2);
+}
+
+static void writeLittleEndian(std::byte* out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out[i] = static_cast<std::byte>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+static uint64_t readLittleEndian(const std::byte* in, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+/* BC1 palette in 4-color mode, as decoded by the GPU */
+static void colorPalette(uint16_t color0, uint16_t color1, int palette[4][3]) {
+  unpackRgb565(color0, palette[0]);
+  unpackRgb565(color1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+}
+
+/* Endpoints are the extremes of the block along its principal axis, found
+   with a few power iterations on the color covariance */
+static void encodeColorBlock(const unsigned char block[BLOCK_TEXELS][4],
+                             std::byte* out) {
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < BLOCK_TEXELS; i++) {
+    for (int c = 0; c < 3; c++) {
+      mean[c] += block[i][c];
+    }
+  }
+  for (float& m : mean) {
+    m /= BLOCK_TEXELS;
+  }
+
+  float covariance[3][3] = {};
+  for (int i = 0; i < BLOCK_TEXELS; i++) {
+    float d[3] = {block[i][0] - mean[0], block[i][1] - mean[1],
+                  block[i][2] - mean[2]};
+    for (int a = 0; a < 3; a++) {
+      for (int b = 0; b < 3; b++) {
+        covariance[a][b] += d[a] * d[b];
+      }
+    }
+  }
+
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 4; iteration++) {
+    float next[3];
+    for (int a = 0; a < 3; a++) {
+      next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] +
+                covariance[a][2] * axis[2];
+    }
+    float length =
+        std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (length < 1e-6f) {
+      break;
+    }
+    for (int a = 0; a < 3; a++) {
+      axis[a] = next[a] / length;
+    }
+  }
+
+  float minProjection = 0.0f;
+  float maxProjection = 0.0f;
+  int minTexel = 0;
+  int maxTexel = 0;
+  for (int i = 0; i < BLOCK_TEXELS; i++) {
+    float projection = (block[i][0] - mean[0]) * axis[0] +
+                       (block[i][1] - mean[1]) * axis[1] +
+                       (block[i][2] - mean[2]) * axis[2];
+    if (i == 0 || projection < minProjection) {
+      minProjection = projection;
+      minTexel = i;
+    }
+    if (i == 0 || projection > maxProjection) {
+      maxProjection = projection;
+      maxTexel = i;
+    }
+  }
+
+  float maxColor[3] = {static_cast<float>(block[maxTexel][0]),
+                       static_cast<float>(block[maxTexel][1]),
+                       static_cast<float>(block[maxTexel][2])};
+  float minColor[3] = {static_cast<float>(block[minTexel][0]),
+                       static_cast<float>(block[minTexel][1]),
+                       static_cast<float>(block[minTexel][2])};
+  uint16_t color0 = packRgb565(maxColor);
+  uint16_t color1 = packRgb565(minColor);
+  /* color0 > color1 selects 4-color mode */
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  uint32_t indices = 0;
+  if (color0 != color1) {
+    int palette[4][3];
+    colorPalette(color0, color1, palette);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+      int best = 0;
+      int bestDistance = -1;
+      for (int p = 0; p < 4; p++) {
+        int distance = 0;
+        for (int c = 0; c < 3; c++) {
+          int d = block[i][c] - palette[p][c];
+          distance += d * d;
+        }
+        if (bestDistance < 0 || distance < bestDistance) {
+          bestDistance = distance;
+          best = p;
+        }
+      }
+      indices |= static_cast<uint32_t>(best) << (2 * i);
+    }
+  }
+
+  writeLittleEndian(out, color0, 2);
+  writeLittleEndian(out + 2, color1, 2);
+  writeLittleEndian(out + 4, indices, 4);
+}
+
+static void decodeColorBlock(const std::byte* in, bool allowThreeColor,
+                             unsigned char block[BLOCK_TEXELS][4]) {
+  uint16_t color0 = static_cast<uint16_t>(readLittleEndian(in, 2));
+  uint16_t color1 = static_cast<uint16_t>(readLittleEndian(in + 2, 2));
+  uint32_t indices = static_cast<uint32_t>(readLittleEndian(in + 4, 4));
+
+  int palette[4][3];
+  int alpha[4] = {255, 255, 255, 255};
+  colorPalette(color0, color1, palette);
+  if (allowThreeColor && color0 <= color1) {
+    for (int c = 0; c < 3; c++) {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+    alpha[3] = 0;
+  }
+
+  for (int i = 0; i < BLOCK_TEXELS; i++) {
+    int index = (indices >> (2 * i)) & 3;
+    for (int c = 0; c < 3; c++) {
+      block[i][c] = static_cast<unsigned char>(palette[index][c]);
+    }
+    block[i][3] = static_cast<unsigned char>(alpha[index]);
+  }
+}
+
+/* BC4 palette; the 8-value mode when value0 > value1 */
+static void channelPalette(int value0, int value1, int palette[8]) {
+  palette[0] = value0;
+  palette[1] = value1;
+  if (value0 > value1) {
+    for (int i = 1; i < 7; i++) {
+      palette[i + 1] = ((7 - i) * value0 + i * value1) / 7;
+    }
+  } else {
+    for (int i = 1; i < 5; i++) {
+      palette[i + 1] = ((5 - i) * value0 + i * value1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+static void encodeChannelBlock(const unsigned char block[BLOCK_TEXELS][4],
+                               int channel, std::byte* out) {
+  int minValue = 255;
+  int maxValue = 0;
+  for (int i = 0; i < BLOCK_TEXELS; i++) {
+    minValue = std::min(minValue, static_cast<int>(block[i][channel]));
+    maxValue = std::max(maxValue, static_cast<int>(block[i][channel]));
+  }
+
+  uint64_t indices = 0;
+  if (maxValue != minValue) {
+    int palette[8];
+    channelPalette(maxValue, minValue, palette);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+      int best = 0;
+      for (int p = 1; p < 8; p++) {
+        if (std::abs(block[i][channel] - palette[p]) <
+            std::abs(block[i][channel] - palette[best])) {
+          best = p;
+        }
+      }
+      indices |= static_cast<uint64_t>(best) << (3 * i);
+    }
+  }
+
+  out[0] = static_cast<std::byte>(maxValue);
+  out[1] = static_cast<std::byte>(minValue);
+  writeLittleEndian(out + 2, indices, 6);
+}
+
+static void decodeChannelBlock(const std::byte* in, int channel,
+                               unsigned char block[BLOCK_TEXELS][4]) {
+  int palette[8];
+  channelPalette(static_cast<int>(in[0]), static_cast<int>(in[1]), palette);
+  uint64_t indices = readLittleEndian(in + 2, 6);
+  for (int i = 0; i < BLOCK_TEXELS; i++) {
+    block[i][channel] =
+        static_cast<unsigned char>(palette[(indices >> (3 * i)) & 7]);
+  }
+}
+
+std::vector<std::byte> compressImage(const unsigned char* rgba, int width,
+                                     int height, TextureCompression format) {
+  int blocksX = std::max(1, (width + BLOCK_DIM - 1) / BLOCK_DIM);
+  int blocksY = std::max(1, (height + BLOCK_DIM - 1) / BLOCK_DIM);
+  size_t blockSize = compressedBlockSize(format);
+  std::vector<std::byte> result(compressedImageSize(format, width, height));
+
+  unsigned char block[BLOCK_TEXELS][4];
+  std::byte* out = result.data();
+  for (int blockY = 0; blockY < blocksY; blockY++) {
+    for (int blockX = 0; blockX < blocksX; blockX++) {
+      fetchBlock(rgba, width, height, blockX, blockY, block);
+      switch (format) {
+        case TextureCompression::BC1:
+          encodeColorBlock(block, out);
+          break;
+        case TextureCompression::BC3:
+          encodeChannelBlock(block, 3, out);
+          encodeColorBlock(block, out + 8);
+          break;
+        case TextureCompression::BC4:
+          encodeChannelBlock(block, 0, out);
+          break;
+        case TextureCompression::BC5:
+          encodeChannelBlock(block, 0, out);
+          encodeChannelBlock(block, 1, out + 8);
+          break;
+      }
+      out += blockSize;
+    }
+  }
+  return result;
+}
+
+std::vector<unsigned char> decompressImage(const std::byte* data, int width,
+                                           int height,
+                                           TextureCompression format) {
+  int blocksX = std::max(1, (width + BLOCK_DIM - 1) / BLOCK_DIM);
+  int blocksY = std::max(1, (height + BLOCK_DIM - 1) / BLOCK_DIM);
+  size_t blockSize = compressedBlockSize(format);
+  std::vector<unsigned char> result(static_cast<size_t>(width) * height * 4);
+
+  unsigned char block[BLOCK_TEXELS][4];
+  const std::byte* in = data;
+  for (int blockY = 0; blockY < blocksY; blockY++) {
+    for (int blockX = 0; blockX < blocksX; blockX++) {
+      for (auto& texel : block) {
+        texel[0] = texel[1] = texel[2] = 0;
+        texel[3] = 255;
+      }
+      switch (format) {
+        case TextureCompression::BC1:
+          decodeColorBlock(in, true, block);
+          break;
+        case TextureCompression::BC3:
+          decodeColorBlock(in + 8, false, block);
+          decodeChannelBlock(in, 3, block);
+          break;
+        case TextureCompression::BC4:
+          decodeChannelBlock(in, 0, block);
+          break;
+        case TextureCompression::BC5:
+          decodeChannelBlock(in, 0, block);
+          decodeChannelBlock(in + 8, 1, block);
+          break;
+      }
+      in += blockSize;
+
+      for (int y = 0; y < BLOCK_DIM; y++) {
+        int targetY = blockY * BLOCK_DIM + y;
+        if (targetY >= height) {
+          break;
+        }
+        for (int x = 0; x < BLOCK_DIM; x++) {
+          int targetX = blockX * BLOCK_DIM + x;
+          if (targetX >= width) {
+            break;
+          }
+          std::memcpy(&result[(static_cast<size_t>(targetY) * width + targetX) *
+                              4],
+                      block[y * BLOCK_DIM + x], 4);
+        }
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,50 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+/* Block-compressed formats, each coding a 4x4 texel block in a fixed number
+   of bytes. All encoders take RGBA8 input; channels a format doesn't store
+   are ignored. */
+enum class TextureCompression {
+  /* RGB 5:6:5 endpoints, 2-bit indices, 8 bytes (S3TC DXT1) */
+  BC1,
+  /* BC1 color plus a BC4 alpha block, 16 bytes (S3TC DXT5) */
+  BC3,
+  /* Single channel, 8-bit endpoints, 3-bit indices, 8 bytes (RGTC1) */
+  BC4,
+  /* Two BC4 blocks for red and green, 16 bytes (RGTC2) */
+  BC5,
+};
+
+size_t compressedBlockSize(TextureCompression format);
+
+size_t compressedImageSize(TextureCompression format, int width, int height);
+
+/* Channels the format stores, as reported by Texture::getChannels() */
+int compressedChannels(TextureCompression format);
+
+GLenum compressedInternalFormat(TextureCompression format);
+
+/* Whether the current context samples the format natively. BC4/BC5 are core
+   since GL 3.0, BC1/BC3 need EXT_texture_compression_s3tc. */
+bool isCompressionSupported(TextureCompression format);
+
+/* Picks the format fitting a source image with the given channel count */
+TextureCompression defaultCompression(int channels);
+
+/* Compresses a tightly packed RGBA8 image. Partial blocks at the right and
+   bottom edges repeat the last texel. */
+std::vector<std::byte> compressImage(const unsigned char* rgba, int width,
+                                     int height, TextureCompression format);
+
+/* Software decoder producing RGBA8, used when the GPU lacks the format.
+   Missing channels decode like the GPU would: green and blue 0, alpha 255. */
+std::vector<unsigned char> decompressImage(const std::byte* data, int width,
+                                           int height,
+                                           TextureCompression format);
+
+#endif /* TEXTURE_COMPRESSION_H */
@@ -0,0 +1,138 @@
+#include "src/texture_container.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "src/exceptions.h"
+
+static constexpr char TEXTURE_CONTAINER_MAGIC[4] = {'C', 'T', 'E', 'X'};
+
+struct TextureContainerHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t compression;
+  uint32_t glInternalFormat;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levelCount;
+  uint32_t padding;
+};
+
+static_assert(std::is_trivially_copyable_v<TextureContainerHeader>);
+
+/* Like the mesh cache, fields are written in host order */
+static_assert(std::endian::native == std::endian::little,
+              "texture containers are little-endian");
+
+bool isTextureContainer(const std::filesystem::path& path) {
+  return path.extension() == TEXTURE_CONTAINER_EXTENSION;
+}
+
+CompressedTexture readTextureContainer(const std::filesystem::path& path,
+                                       int maxSize) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw FileNotFoundException("Cannot open texture " + path.string());
+  }
+  /* Level sizes are checked against what is left before allocating */
+  size_t remaining = static_cast<size_t>(file.tellg());
+  file.seekg(0);
+
+  TextureContainerHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file ||
+      std::memcmp(header.magic, TEXTURE_CONTAINER_MAGIC,
+                  sizeof(header.magic)) != 0) {
+    throw ResourceException(path.string() + " is not a texture container");
+  }
+  if (header.version != TEXTURE_CONTAINER_VERSION) {
+    throw ResourceException(path.string() + " has container version " +
+                            std::to_string(header.version) + ", expected " +
+                            std::to_string(TEXTURE_CONTAINER_VERSION));
+  }
+  if (header.compression >
+          static_cast<uint32_t>(TextureCompression::BC5) ||
+      header.width == 0 || header.height == 0 || header.levelCount == 0 ||
+      header.levelCount > 32) {
+    throw ResourceException(path.string() + " has an invalid header");
+  }
+  if (header.width > static_cast<uint32_t>(maxSize) ||
+      header.height > static_cast<uint32_t>(maxSize)) {
+    throw ResourceException(path.string() + " is " +
+                            std::to_string(header.width) + "x" +
+                            std::to_string(header.height) +
+                            ", larger than the GPU supports");
+  }
+  remaining -= std::min(remaining, sizeof(header));
+
+  CompressedTexture texture;
+  texture.format = static_cast<TextureCompression>(header.compression);
+  texture.width = static_cast<int>(header.width);
+  texture.height = static_cast<int>(header.height);
+
+  int levelWidth = texture.width;
+  int levelHeight = texture.height;
+  for (uint32_t level = 0; level < header.levelCount; level++) {
+    uint32_t imageSize = 0;
+    file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize));
+    if (!file || imageSize != compressedImageSize(texture.format, levelWidth,
+                                                  levelHeight)) {
+      throw ResourceException(path.string() + " has a truncated or invalid " +
+                              "mip level " + std::to_string(level));
+    }
+    remaining -= std::min(remaining, sizeof(imageSize));
+    if (imageSize > remaining) {
+      throw ResourceException(path.string() + " is truncated");
+    }
+    remaining -= imageSize;
+
+    size_t offset = texture.data.size();
+    texture.data.resize(offset + imageSize);
+    file.read(reinterpret_cast<char*>(texture.data.data() + offset),
+              imageSize);
+    if (!file) {
+      throw ResourceException(path.string() + " is truncated");
+    }
+    texture.levels.push_back({levelWidth, levelHeight, offset, imageSize});
+
+    levelWidth = std::max(1, levelWidth / 2);
+    levelHeight = std::max(1, levelHeight / 2);
+  }
+  return texture;
+}
+
+void writeTextureContainer(const std::filesystem::path& path,
+                           const CompressedTexture& texture) {
+  TextureContainerHeader header = {};
+  std::memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(header.magic));
+  header.version = TEXTURE_CONTAINER_VERSION;
+  header.compression = static_cast<uint32_t>(texture.format);
+  header.glInternalFormat = compressedInternalFormat(texture.format);
+  header.width = static_cast<uint32_t>(texture.width);
+  header.height = static_cast<uint32_t>(texture.height);
+  header.levelCount = static_cast<uint32_t>(texture.levels.size());
+
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw ResourceException("Cannot write texture " + tempPath.string());
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const CompressedMipLevel& level : texture.levels) {
+      uint32_t imageSize = static_cast<uint32_t>(level.size);
+      file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+      file.write(reinterpret_cast<const char*>(texture.data.data() +
+                                               level.offset),
+                 level.size);
+    }
+    if (!file) {
+      throw ResourceException("Failed writing texture " + tempPath.string());
+    }
+  }
+  std::filesystem::rename(tempPath, path);
+}
@@ -0,0 +1,51 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "src/texture_compression.h"
+
+struct CompressedMipLevel {
+  int width;
+  int height;
+  /* Byte range of the level inside CompressedTexture::data */
+  size_t offset;
+  size_t size;
+};
+
+/* A block-compressed image with its full mip chain, level 0 first */
+struct CompressedTexture {
+  TextureCompression format;
+  int width;
+  int height;
+  std::vector<CompressedMipLevel> levels;
+  std::vector<std::byte> data;
+};
+
+/* Cooked textures are stored in a KTX-like little-endian container:
+
+     TextureContainerHeader | (uint32 imageSize | level data) * levelCount
+
+   Levels are stored exactly as glCompressedTexImage2D consumes them.
+   Bump TEXTURE_CONTAINER_VERSION whenever the layout changes. */
+static constexpr uint32_t TEXTURE_CONTAINER_VERSION = 1;
+
+/* Files with this extension are loaded as cooked textures */
+static constexpr const char* TEXTURE_CONTAINER_EXTENSION = ".ctex";
+
+bool isTextureContainer(const std::filesystem::path& path);
+
+/* Throws ResourceException for malformed files, including ones larger
+   than maxSize on a side. Pass GL_MAX_TEXTURE_SIZE, queried on the GL
+   thread, since this also runs on loader threads. */
+CompressedTexture readTextureContainer(const std::filesystem::path& path,
+                                       int maxSize);
+
+/* Writes to a temporary file and renames it over path */
+void writeTextureContainer(const std::filesystem::path& path,
+                           const CompressedTexture& texture);
+
+#endif /* TEXTURE_CONTAINER_H */
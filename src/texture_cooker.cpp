@@ -0,0 +1,48 @@
+#include "src/texture_cooker.h"
+
+static std::vector<unsigned char> expandToRgba(const unsigned char* pixels,
+                                               int width, int height,
+                                               int channels) {
+  size_t texels = static_cast<size_t>(width) * height;
+  std::vector<unsigned char> rgba(texels * 4);
+  for (size_t i = 0; i < texels; i++) {
+    const unsigned char* source = pixels + i * channels;
+    unsigned char* target = &rgba[i * 4];
+    if (channels <= 2) {
+      /* Gray (+ alpha) keeps its value in red so BC4/BC5 pick it up */
+      target[0] = source[0];
+      target[1] = channels == 2 ? source[1] : 0;
+      target[2] = 0;
+      target[3] = 255;
+    } else {
+      target[0] = source[0];
+      target[1] = source[1];
+      target[2] = source[2];
+      target[3] = channels == 4 ? source[3] : 255;
+    }
+  }
+  return rgba;
+}
+
+CompressedTexture cookTexture(const unsigned char* pixels, int width,
+                              int height, int channels,
+                              TextureCompression format,
+                              const MipChainOptions& options) {
+  CompressedTexture texture;
+  texture.format = format;
+  texture.width = width;
+  texture.height = height;
+
+  MipChain chain = generateMipChain(pixels, width, height, channels, options);
+  for (const MipLevel& level : chain.levels) {
+    std::vector<unsigned char> rgba = expandToRgba(
+        chain.data.data() + level.offset, level.width, level.height, channels);
+    std::vector<std::byte> compressed =
+        compressImage(rgba.data(), level.width, level.height, format);
+    texture.levels.push_back(
+        {level.width, level.height, texture.data.size(), compressed.size()});
+    texture.data.insert(texture.data.end(), compressed.begin(),
+                        compressed.end());
+  }
+  return texture;
+}
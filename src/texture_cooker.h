@@ -0,0 +1,14 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include "src/mipmap_generator.h"
+#include "src/texture_container.h"
+
+/* Builds the full mip chain of an 8-bit image with 1-4 channels and
+   block-compresses every level */
+CompressedTexture cookTexture(const unsigned char* pixels, int width,
+                              int height, int channels,
+                              TextureCompression format,
+                              const MipChainOptions& options = {});
+
+#endif /* TEXTURE_COOKER_H */
@@ -0,0 +1,186 @@
+#include "src/texture_loader.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <stb_image.h>
+
+#include "src/logger.h"
+#include "src/thread_pool.h"
+
+TextureLoader::TextureLoader()
+    : queue(std::make_shared<Queue>()),
+      pbos{0, 0},
+      nextPbo(0),
+      initialized(false),
+      retainSources(false),
+      maxTextureSize(0) {}
+
+TextureLoader::~TextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->cancelled = true;
+    queue->images.clear();
+  }
+  if (initialized) {
+    glDeleteBuffers(PBO_COUNT, pbos);
+  }
+}
+
+void TextureLoader::initGL() {
+  glGenBuffers(PBO_COUNT, pbos);
+  initialized = true;
+}
+
+void TextureLoader::load(const std::shared_ptr<Texture2D>& texture,
+                         const std::filesystem::path& path, bool srgb) {
+  LOG_INFO("Queueing texture from ", path);
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->inFlight++;
+  }
+
+  /* Workers have no GL context to ask */
+  if (maxTextureSize == 0) {
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+  }
+
+  std::weak_ptr<Texture2D> target = texture;
+  std::shared_ptr<Queue> results = queue;
+  GLint maxSize = maxTextureSize;
+  ThreadPool::background().submit([results, target, path, srgb, maxSize]() {
+    {
+      std::lock_guard<std::mutex> lock(results->mutex);
+      if (results->cancelled) {
+        return;
+      }
+    }
+    /* The flip flag is global unless set per thread */
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    DecodedImage image{target, path, std::nullopt, std::nullopt, ""};
+    if (isTextureContainer(path)) {
+      try {
+        image.compressed = readTextureContainer(path, maxSize);
+      } catch (const std::exception& e) {
+        image.error = e.what();
+      }
+    } else {
+      int width = 0;
+      int height = 0;
+      int channels = 0;
+      unsigned char* pixels =
+          stbi_load(path.c_str(), &width, &height, &channels, 0);
+      if (pixels) {
+        MipChainOptions options;
+        options.srgb = srgb;
+        /* Already on a pool worker, other textures provide the parallelism */
+        options.parallel = false;
+        image.mips = generateMipChain(pixels, width, height, channels, options);
+        stbi_image_free(pixels);
+      } else {
+        image.error = stbi_failure_reason();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(results->mutex);
+    /* Nobody would upload it; image frees its pixels on the way out */
+    if (!results->cancelled) {
+      results->images.push_back(std::move(image));
+    }
+  });
+}
+
+bool TextureLoader::stage(const void* data, size_t size) {
+  if (!initialized) {
+    initGL();
+  }
+
+  /* Alternating between buffers lets the driver keep reading the previous
+     upload while the next one is being written */
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+  nextPbo = (nextPbo + 1) % PBO_COUNT;
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  void* mapped = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+  std::memcpy(mapped, data, size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  return true;
+}
+
+void TextureLoader::uploadImage(DecodedImage& image) {
+  std::shared_ptr<Texture2D> texture = image.texture.lock();
+  if (!texture) {
+    return;
+  }
+
+  if (image.compressed) {
+    const CompressedTexture& compressed = *image.compressed;
+    /* Software decoding needs the bytes on the CPU */
+    if (isCompressionSupported(compressed.format) &&
+        stage(compressed.data.data(), compressed.data.size())) {
+      texture->uploadCompressed(compressed, nullptr);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+      texture->uploadCompressed(compressed, compressed.data.data());
+    }
+    if (retainSources) {
+      texture->retainSource(std::move(*image.compressed));
+    }
+  } else {
+    const MipChain& mips = *image.mips;
+    if (stage(mips.data.data(), mips.data.size())) {
+      texture->uploadMipChain(mips, nullptr);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+      LOG_WARNING("Failed to map pixel buffer, uploading ", image.path,
+                  " directly");
+      texture->uploadMipChain(mips, mips.data.data());
+    }
+    if (retainSources) {
+      texture->retainSource(std::move(*image.mips));
+    }
+  }
+
+  LOG_INFO("Texture '", texture->getName(), "' uploaded (",
+           texture->getWidth(), "x", texture->getHeight(), ")");
+}
+
+void TextureLoader::update(float budgetMs) {
+  auto start = std::chrono::steady_clock::now();
+  auto budget = std::chrono::duration<float, std::milli>(budgetMs);
+
+  while (true) {
+    DecodedImage image{};
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (queue->images.empty()) {
+        return;
+      }
+      image = std::move(queue->images.front());
+      queue->images.pop_front();
+      queue->inFlight--;
+    }
+
+    if (image.error.empty()) {
+      uploadImage(image);
+    } else {
+      LOG_ERROR("Failed to load texture: ", image.path, " (", image.error,
+                ")");
+    }
+
+    if (std::chrono::steady_clock::now() - start >= budget) {
+      return;
+    }
+  }
+}
+
+size_t TextureLoader::pendingCount() const {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->inFlight;
+}
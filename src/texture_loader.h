@@ -0,0 +1,83 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "src/texture2d.h"
+
+/* Decodes images on ThreadPool::background() and streams them into their
+   textures through pixel unpack buffers. update() must run on the GL
+   thread. */
+class TextureLoader {
+ private:
+  static constexpr size_t PBO_COUNT = 2;
+
+  struct DecodedImage {
+    std::weak_ptr<Texture2D> texture;
+    std::filesystem::path path;
+    /* Exactly one of these is set unless decoding failed */
+    std::optional<MipChain> mips;
+    std::optional<CompressedTexture> compressed;
+    /* Failure reasons are per thread in stb, so they travel along */
+    std::string error;
+  };
+
+  /* Shared with the decode jobs, which may outlive the loader */
+  struct Queue {
+    std::mutex mutex;
+    std::deque<DecodedImage> images;
+    size_t inFlight = 0;
+    /* Set by the loader's destructor; jobs then skip or drop their work */
+    bool cancelled = false;
+  };
+
+  std::shared_ptr<Queue> queue;
+  GLuint pbos[PBO_COUNT];
+  size_t nextPbo;
+  bool initialized;
+  bool retainSources;
+  /* GL_MAX_TEXTURE_SIZE, queried on the first load */
+  GLint maxTextureSize;
+
+  void initGL();
+  /* Moves the decoded data into the texture when sources are retained */
+  void uploadImage(DecodedImage& image);
+  /* Copies size bytes into the next pixel buffer and leaves it bound.
+     Returns false with no buffer bound if mapping failed. */
+  bool stage(const void* data, size_t size);
+
+ public:
+  TextureLoader();
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader&) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
+
+  /* Starts decoding path in the background and builds its mip chain on the
+     same worker, filtering in linear light when srgb is set. texture keeps
+     its placeholder until the image is uploaded by update(). Cooked .ctex
+     files are read as is and uploaded compressed. */
+  void load(const std::shared_ptr<Texture2D>& texture,
+            const std::filesystem::path& path, bool srgb = true);
+
+  /* Uploads decoded images until budgetMs has been spent. At least one image
+     is uploaded per call so large textures cannot stall the queue. */
+  void update(float budgetMs);
+
+  /* Hands every uploaded chain to its texture so it can be streamed, see
+     Texture2D::retainSource(). Costs a CPU copy of each texture. */
+  void setRetainSources(bool retain) { retainSources = retain; }
+
+  /* Images still being decoded or waiting for upload */
+  size_t pendingCount() const;
+};
+
+#endif /* TEXTURE_LOADER_H */
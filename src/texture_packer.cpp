@@ -0,0 +1,125 @@
+#include "src/texture_packer.h"
+
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <utility>
+
+#include "src/logger.h"
+
+TexturePacker::TexturePacker() : framebuffer(0), initialized(false) {}
+
+TexturePacker::~TexturePacker() {
+  if (initialized) {
+    glDeleteFramebuffers(1, &framebuffer);
+  }
+}
+
+void TexturePacker::initGL() {
+  glGenFramebuffers(1, &framebuffer);
+  initialized = true;
+}
+
+size_t TexturePacker::pack(const std::vector<Texture2D*>& textures) {
+  std::map<std::pair<int, int>, std::vector<Texture2D*>> groups;
+  for (Texture2D* texture : textures) {
+    if (!texture->isLoaded() || texture->isCompressed() ||
+        texture->getSlot() || texture->getWidth() > MAX_PACKED_SIZE ||
+        texture->getHeight() > MAX_PACKED_SIZE) {
+      continue;
+    }
+    /* Streamed-out textures would be copied at their reduced size, bring
+       them back first; they aren't streamed once packed */
+    if (texture->getResidentLevel() > 0) {
+      if (!texture->isStreamable()) {
+        continue;
+      }
+      texture->setResidentLevel(0);
+    }
+    groups[{texture->getWidth(), texture->getHeight()}].push_back(texture);
+  }
+  if (groups.empty()) {
+    return 0;
+  }
+
+  if (!initialized) {
+    initGL();
+  }
+
+  GLint maxLayers = 256;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+  size_t packed = 0;
+  for (auto& [size, group] : groups) {
+    /* At least maxLayers tiles fit in one array whatever the grid */
+    size_t perArray = static_cast<size_t>(maxLayers);
+
+    for (size_t start = 0; start < group.size(); start += perArray) {
+      size_t count = std::min(perArray, group.size() - start);
+      std::vector<Texture2D*> chunk(group.begin() + start,
+                                    group.begin() + start + count);
+      packGroup(chunk);
+      packed += count;
+    }
+  }
+  LOG_INFO("Packed ", packed, " textures, ", arrays.size(),
+           " texture arrays in use");
+  return packed;
+}
+
+size_t TexturePacker::getBytes() const {
+  size_t bytes = 0;
+  for (const std::shared_ptr<TextureArray>& array : arrays) {
+    bytes += array->getBytes();
+  }
+  return bytes;
+}
+
+void TexturePacker::packGroup(const std::vector<Texture2D*>& group) {
+  int tileWidth = group[0]->getWidth();
+  int tileHeight = group[0]->getHeight();
+  int count = static_cast<int>(group.size());
+
+  /* Only power-of-two tiles stay on whole texels down the mip chain, other
+     sizes get a layer each */
+  bool atlas = std::has_single_bit(static_cast<unsigned>(tileWidth)) &&
+               std::has_single_bit(static_cast<unsigned>(tileHeight));
+  int columns = atlas ? std::max(1, ATLAS_LAYER_SIZE / tileWidth) : 1;
+  int rows = atlas ? std::max(1, ATLAS_LAYER_SIZE / tileHeight) : 1;
+  /* Don't allocate a whole atlas layer for a handful of tiles */
+  if (count < columns * rows) {
+    columns = std::min(columns, count);
+    rows = (count + columns - 1) / columns;
+  }
+  int layers = (count + columns * rows - 1) / (columns * rows);
+
+  int levelCount = 32;
+  for (Texture2D* texture : group) {
+    levelCount = std::min(levelCount, texture->getLevelCount());
+  }
+  if (columns * rows > 1) {
+    /* Below the level where the smaller side of a tile reaches one texel,
+       tiles would blend into their neighbours */
+    unsigned smallerSide =
+        static_cast<unsigned>(std::min(tileWidth, tileHeight));
+    int tileLevels = std::countr_zero(smallerSide) + 1;
+    levelCount = std::min(levelCount, tileLevels);
+  }
+
+  auto array = std::make_shared<TextureArray>(tileWidth, tileHeight, columns,
+                                              rows, layers, levelCount);
+  array->setName("packed " + std::to_string(tileWidth) + "x" +
+                 std::to_string(tileHeight));
+
+  for (int tile = 0; tile < count; tile++) {
+    Texture2D* texture = group[tile];
+    if (!array->copyTile(tile, texture->getId(), framebuffer)) {
+      continue;
+    }
+    texture->setSlot({array, array->layerOf(tile), array->rectOf(tile)});
+  }
+  LOG_INFO("Texture array ", array->getName(), ": ", count, " textures in ",
+           columns, "x", rows, " tiles over ", layers, " layers, ",
+           levelCount, " levels");
+  arrays.push_back(std::move(array));
+}
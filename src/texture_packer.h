@@ -0,0 +1,49 @@
+#ifndef TEXTURE_PACKER_H
+#define TEXTURE_PACKER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "src/texture2d.h"
+#include "src/texture_array.h"
+
+/* Copies loaded textures into shared TextureArrays so materials can sample
+   them by layer and batch together. Textures of one size share an array;
+   sizes below ATLAS_LAYER_SIZE are tiled several to a layer. Compressed
+   textures and ones above MAX_PACKED_SIZE keep only their own storage.
+   Packed textures stay usable on their own for sampler2D shaders, and at
+   full size: the streamer leaves them alone, as the copy in the array
+   couldn't follow. */
+class TexturePacker {
+ public:
+  static constexpr int ATLAS_LAYER_SIZE = 1024;
+  static constexpr int MAX_PACKED_SIZE = 4096;
+
+ private:
+  std::vector<std::shared_ptr<TextureArray>> arrays;
+  GLuint framebuffer;
+  bool initialized;
+
+  void initGL();
+  void packGroup(const std::vector<Texture2D*>& group);
+
+ public:
+  TexturePacker();
+  ~TexturePacker();
+
+  TexturePacker(const TexturePacker&) = delete;
+  TexturePacker& operator=(const TexturePacker&) = delete;
+
+  /* Packs every loaded texture that has no slot yet. Returns how many were
+     packed. */
+  size_t pack(const std::vector<Texture2D*>& textures);
+
+  size_t getArrayCount() const { return arrays.size(); }
+  /* GPU bytes of every array */
+  size_t getBytes() const;
+};
+
+#endif /* TEXTURE_PACKER_H */
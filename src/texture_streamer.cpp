@@ -0,0 +1,123 @@
+#include "src/texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "src/logger.h"
+
+TextureStreamer::TextureStreamer(size_t budgetBytes)
+    : budgetBytes(budgetBytes), stats{} {}
+
+int TextureStreamer::desiredLevel(const Texture2D& texture, int minLevel) {
+  uint64_t idleFrames =
+      Texture::getCurrentFrame() - texture.getLastUsedFrame();
+  if (idleFrames > IDLE_FRAMES) {
+    return minLevel;
+  }
+
+  /* Bound but never sized by the scene, e.g. UI: keep it sharp */
+  float pixels = texture.getRequestedScreenSize();
+  if (pixels <= 0.0F) {
+    return 0;
+  }
+  float size = static_cast<float>(
+      std::max(texture.getWidth(), texture.getHeight()));
+  int level = static_cast<int>(std::floor(std::log2(size / pixels)));
+  return std::clamp(level, 0, minLevel);
+}
+
+void TextureStreamer::update(const std::vector<Texture2D*>& textures,
+                             size_t arrayBytes) {
+  stats = TextureStreamingStats{};
+  stats.budgetBytes = budgetBytes;
+  stats.textureCount = textures.size();
+  stats.arrayBytes = arrayBytes;
+  candidates.clear();
+
+  size_t plannedBytes = arrayBytes;
+  for (Texture2D* texture : textures) {
+    if (!texture->isLoaded() || !texture->isStreamable() ||
+        texture->getSlot()) {
+      plannedBytes += texture->getResidentBytes();
+      continue;
+    }
+
+    int levels = texture->getSourceLevelCount();
+    int size = std::max(texture->getWidth(), texture->getHeight());
+    int minLevel = 0;
+    while (minLevel + 1 < levels && (size >> minLevel) > MIN_RESIDENT_SIZE) {
+      minLevel++;
+    }
+
+    /* One level of slack before dropping, so a texture hovering around a
+       level boundary isn't re-uploaded every few frames */
+    int desired = desiredLevel(*texture, minLevel);
+    int resident = texture->getResidentLevel();
+    int target = resident;
+    if (desired < resident) {
+      target = desired;
+    } else if (desired - 1 > resident) {
+      target = desired - 1;
+    }
+
+    candidates.push_back({texture, target, minLevel});
+    plannedBytes += texture->getResidentBytesFrom(target);
+  }
+
+  /* Over budget: take levels from the least recently used first */
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.texture->getLastUsedFrame() <
+                            b.texture->getLastUsedFrame();
+                   });
+  for (Candidate& candidate : candidates) {
+    Texture2D* texture = candidate.texture;
+    while (plannedBytes > budgetBytes &&
+           candidate.target < candidate.minLevel) {
+      plannedBytes -= texture->getResidentBytesFrom(candidate.target);
+      candidate.target++;
+      plannedBytes += texture->getResidentBytesFrom(candidate.target);
+    }
+  }
+  if (plannedBytes > budgetBytes) {
+    LOG_DEBUG("Texture budget of ", budgetBytes, " B exceeded even at minimum",
+              " residency: ", plannedBytes, " B");
+  }
+
+  /* Free memory before anything is streamed in */
+  for (Candidate& candidate : candidates) {
+    if (candidate.target > candidate.texture->getResidentLevel()) {
+      LOG_DEBUG("Streaming out texture '", candidate.texture->getName(),
+                "' to level ", candidate.target);
+      candidate.texture->setResidentLevel(candidate.target);
+      stats.streamedOut++;
+    }
+  }
+
+  /* Most recently used first, so what is on screen sharpens first */
+  size_t uploadedBytes = 0;
+  for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+    Texture2D* texture = it->texture;
+    if (it->target >= texture->getResidentLevel()) {
+      continue;
+    }
+    size_t bytes = texture->getResidentBytesFrom(it->target);
+    if (uploadedBytes > 0 && uploadedBytes + bytes > UPLOAD_BYTES_PER_UPDATE) {
+      stats.deferred++;
+      continue;
+    }
+    LOG_DEBUG("Streaming in texture '", texture->getName(), "' to level ",
+              it->target);
+    texture->setResidentLevel(it->target);
+    uploadedBytes += bytes;
+    stats.streamedIn++;
+  }
+
+  stats.residentBytes = arrayBytes;
+  for (Texture2D* texture : textures) {
+    stats.residentBytes += texture->getResidentBytes();
+    if (texture->isStreamable() && texture->getResidentLevel() > 0) {
+      stats.reducedTextures++;
+    }
+  }
+}
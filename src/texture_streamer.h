@@ -0,0 +1,74 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "src/texture2d.h"
+
+struct TextureStreamingStats {
+  /* GPU bytes of every texture passed to the last update, plus
+     arrayBytes */
+  size_t residentBytes;
+  /* GPU bytes of texture arrays, which count against the budget but are
+     never streamed */
+  size_t arrayBytes;
+  size_t budgetBytes;
+  size_t textureCount;
+  /* Streamable textures with their largest levels dropped */
+  size_t reducedTextures;
+  /* Level changes made by the last update */
+  size_t streamedIn;
+  size_t streamedOut;
+  /* Stream-ins left for later frames by the upload limit */
+  size_t deferred;
+};
+
+/* Keeps streamable textures (see Texture2D::retainSource) within a GPU
+   memory budget. Each frame picks a top mip level per texture from its
+   requested screen size and when it was last bound, then drops levels of
+   the least recently used textures until the budget is met. Packed
+   textures (see TexturePacker) stay as they are. */
+class TextureStreamer {
+ public:
+  static constexpr size_t DEFAULT_BUDGET_BYTES = 256u << 20;
+  /* Textures stay at least this large on their longer side */
+  static constexpr int MIN_RESIDENT_SIZE = 64;
+  /* Textures not bound for this many frames fall to MIN_RESIDENT_SIZE */
+  static constexpr uint64_t IDLE_FRAMES = 300;
+  /* Bytes of stream-in uploads per update, at least one texture goes in */
+  static constexpr size_t UPLOAD_BYTES_PER_UPDATE = 16u << 20;
+
+ private:
+  struct Candidate {
+    Texture2D* texture;
+    int target;
+    /* Coarsest level the texture may be dropped to */
+    int minLevel;
+  };
+
+  size_t budgetBytes;
+  TextureStreamingStats stats;
+  /* Scratch buffer reused across updates */
+  std::vector<Candidate> candidates;
+
+  /* Level wanted for the texture's screen size and recency, without the
+     budget */
+  static int desiredLevel(const Texture2D& texture, int minLevel);
+
+ public:
+  explicit TextureStreamer(size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+  void setBudget(size_t bytes) { budgetBytes = bytes; }
+  size_t getBudget() const { return budgetBytes; }
+
+  /* Streams levels of the given textures in and out, leaving room for
+     arrayBytes of texture arrays. Call once per frame on the GL thread,
+     before Texture::advanceFrame(). */
+  void update(const std::vector<Texture2D*>& textures, size_t arrayBytes = 0);
+
+  const TextureStreamingStats& getStats() const { return stats; }
+};
+
+#endif /* TEXTURE_STREAMER_H */
@@ -0,0 +1,99 @@
+#include "src/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(size_t threadCount) : stopping(false) {
+  for (size_t i = 0; i < threadCount; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  /* Join before jobs, mutex and condition, which the workers still use,
+     are destroyed */
+  workers.clear();
+}
+
+ThreadPool& ThreadPool::global() {
+  static ThreadPool pool(
+      std::max(2U, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+ThreadPool& ThreadPool::background() {
+  static ThreadPool pool(
+      std::max(2U, std::thread::hardware_concurrency() / 2));
+  return pool;
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+      if (stopping && jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    job();
+  }
+}
+
+void ThreadPool::parallelFor(size_t count,
+                             const std::function<void(size_t)>& func) {
+  if (count == 0) {
+    return;
+  }
+
+  /* Helpers may only get to run after the caller returned, behind other
+     jobs, so what they touch is shared and func is only called while the
+     caller waits for it */
+  struct Shared {
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t active = 0;
+  };
+  auto shared = std::make_shared<Shared>();
+  auto drain = [count, &func](Shared& state) {
+    for (size_t i = state.next++; i < count; i = state.next++) {
+      func(i);
+    }
+  };
+
+  size_t helpers = std::min(workers.size(), count - 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < helpers; i++) {
+      jobs.emplace_back([shared, drain, count]() {
+        {
+          std::lock_guard<std::mutex> lock(shared->mutex);
+          if (shared->next >= count) {
+            return;
+          }
+          shared->active++;
+        }
+        drain(*shared);
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (--shared->active == 0) {
+          shared->finished.notify_one();
+        }
+      });
+    }
+  }
+  condition.notify_all();
+
+  drain(*shared);
+  /* The range is taken; only helpers already inside it are waited for */
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  shared->finished.wait(lock, [&shared]() { return shared->active == 0; });
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+ private:
+  std::vector<std::jthread> workers;
+  std::deque<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping;
+
+  void workerLoop();
+
+ public:
+  explicit ThreadPool(size_t threadCount);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /* Process-wide pool sized to the hardware, created on first use */
+  static ThreadPool& global();
+  /* Separate pool for long jobs such as asset decoding, so they never sit
+     in front of the short per-frame work queued on global() */
+  static ThreadPool& background();
+
+  size_t size() const { return workers.size(); }
+
+  template <typename Func>
+  std::future<std::invoke_result_t<Func>> submit(Func func) {
+    using Result = std::invoke_result_t<Func>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+    std::future<Result> future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.emplace_back([task]() { (*task)(); });
+    }
+    condition.notify_one();
+    return future;
+  }
+
+  /* Runs func(i) for i in [0, count) and blocks until all calls finished.
+     The calling thread takes part in the work and never waits on other
+     queued jobs: helpers that start after it drained the range do
+     nothing. */
+  void parallelFor(size_t count, const std::function<void(size_t)>& func);
+};
+
+#endif /* THREAD_POOL_H */
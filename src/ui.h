@@ -3,12 +3,16 @@
 
 #include <memory>
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "src/font_atlas.h"
+#include "src/text_batcher.h"
 #include "src/uitext.h"
 
 class UI {
  private:
   std::unordered_map<std::string, std::unique_ptr<UIText>> texts;
+  TextBatcher batcher;
 
  public:
   void addText(std::string name, std::shared_ptr<FontAtlas> font,
@@ -19,11 +23,21 @@ class UI {
                                        glm::vec3(1.0F), scale)));
   }
 
+  /* All texts in one draw per font atlas, sharing one projection */
   void render(Shader* shader, int screenWidth, int screenHeight) {
+    if (texts.empty()) {
+      return;
+    }
     shader->use();
+    shader->setUniform(
+        "projection", glm::ortho(0.0f, (float)screenWidth, 0.0f,
+                                 (float)screenHeight));
+    shader->setUniform("fontAtlas",
+                       static_cast<int>(TextBatcher::ATLAS_UNIT));
     for (auto& text : texts) {
-      text.second->draw(shader, screenWidth, screenHeight);
+      text.second->addTo(batcher);
     }
+    batcher.flush(shader);
   }
 };
 
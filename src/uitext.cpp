@@ -11,18 +11,12 @@ UIText::UIText(std::shared_ptr<FontAtlas> font, glm::vec2 pos, std::string text,
       color(color),
       scale(scale) {}
 
-void UIText::draw(Shader* shader, int screenWidth, int screenHeight) {
-  glm::mat4 projection =
-      glm::ortho(0.0f, (float)screenWidth, 0.0f, (float)screenHeight);
+void UIText::addTo(TextBatcher& batcher) {
   glm::mat4 model =
       glm::translate(glm::mat4(1.0f), glm::vec3(screenPosition, 0.0f));
   model = glm::scale(model, glm::vec3(scale));
 
-  LOG_DEBUG("Drawing text: ", textMesh.getText());
+  LOG_DEBUG("Queueing text: ", textMesh.getText());
 
-  font->bind(0);
-  shader->setUniform("fontAtlas", 0);
-  shader->setUniform("model", projection * model);
-  shader->setUniform("textColor", color);
-  textMesh.draw();
+  batcher.add(textMesh, model, glm::vec4(color, 1.0F));
 }
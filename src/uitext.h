@@ -5,7 +5,7 @@
 
 #include "src/font_atlas.h"
 #include "src/logger.h"
-#include "src/shader.h"
+#include "src/text_batcher.h"
 #include "src/text_mesh.h"
 
 class UIText {
@@ -20,7 +20,8 @@ class UIText {
   UIText(std::shared_ptr<FontAtlas> font, glm::vec2 pos, std::string text = "",
          glm::vec3 color = glm::vec3(1.0F), float scale = 1);
 
-  void draw(Shader* shader, int screenWidth, int screenHeight);
+  /* Queues the text in screen space; the projection is set per batch */
+  void addTo(TextBatcher& batcher);
 };
 
 #endif /* UITEXT_H */
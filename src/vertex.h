@@ -4,24 +4,26 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "src/vertex_layout.h"
+
 struct Vertex {
   glm::vec3 position;
   glm::vec3 normal;
   glm::vec2 texCoords;
 
-  static void enableVertexAttribArray() {
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void*)offsetof(Vertex, position));
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void*)offsetof(Vertex, normal));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void*)offsetof(Vertex, texCoords));
+  static const VertexLayout& layout() {
+    static const VertexLayout vertexLayout = {
+        sizeof(Vertex),
+        {
+            {0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position)},
+            {1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal)},
+            {2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoords)},
+        },
+    };
+    return vertexLayout;
   }
+
+  static void enableVertexAttribArray() { layout().enable(); }
 };
 
 #endif /* VERTEX_H */
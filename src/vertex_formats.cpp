@@ -0,0 +1,143 @@
+#include "src/vertex_formats.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+/* Largest finite half float */
+constexpr float HALF_MAX = 65504.0F;
+
+float signNotZero(float value) {
+  return value >= 0.0F ? 1.0F : -1.0F;
+}
+
+void packPosition(const glm::vec3& position, uint16_t out[4]) {
+  out[0] = glm::packHalf1x16(position.x);
+  out[1] = glm::packHalf1x16(position.y);
+  out[2] = glm::packHalf1x16(position.z);
+  out[3] = glm::packHalf1x16(1.0F);
+}
+
+void packTexCoords(const glm::vec2& texCoords, uint16_t out[2]) {
+  out[0] = glm::packUnorm1x16(texCoords.x);
+  out[1] = glm::packUnorm1x16(texCoords.y);
+}
+
+template <typename V, typename PackFunc>
+std::vector<std::byte> packAll(const std::vector<Vertex>& vertices,
+                               PackFunc pack) {
+  std::vector<std::byte> data(vertices.size() * sizeof(V));
+  for (size_t i = 0; i < vertices.size(); i++) {
+    V packed = pack(vertices[i]);
+    std::memcpy(data.data() + i * sizeof(V), &packed, sizeof(V));
+  }
+  return data;
+}
+
+}  // namespace
+
+const VertexLayout& CompactVertex::layout() {
+  static const VertexLayout vertexLayout = {
+      sizeof(CompactVertex),
+      {
+          {0, 3, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactVertex, position)},
+          {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+           offsetof(CompactVertex, normal)},
+          {2, 2, GL_UNSIGNED_SHORT, GL_TRUE,
+           offsetof(CompactVertex, texCoords)},
+      },
+  };
+  return vertexLayout;
+}
+
+const VertexLayout& OctahedralVertex::layout() {
+  static const VertexLayout vertexLayout = {
+      sizeof(OctahedralVertex),
+      {
+          {0, 3, GL_HALF_FLOAT, GL_FALSE,
+           offsetof(OctahedralVertex, position)},
+          {1, 2, GL_SHORT, GL_TRUE, offsetof(OctahedralVertex, normal)},
+          {2, 2, GL_UNSIGNED_SHORT, GL_TRUE,
+           offsetof(OctahedralVertex, texCoords)},
+      },
+  };
+  return vertexLayout;
+}
+
+const VertexLayout& vertexFormatLayout(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::COMPACT:
+      return CompactVertex::layout();
+    case VertexFormat::OCTAHEDRAL:
+      return OctahedralVertex::layout();
+    case VertexFormat::FLOAT32:
+      break;
+  }
+  return Vertex::layout();
+}
+
+bool fitsCompactFormat(const std::vector<Vertex>& vertices) {
+  for (const Vertex& vertex : vertices) {
+    for (int i = 0; i < 3; i++) {
+      if (!(std::abs(vertex.position[i]) <= HALF_MAX)) {
+        return false;
+      }
+    }
+    for (int i = 0; i < 2; i++) {
+      if (!(vertex.texCoords[i] >= 0.0F && vertex.texCoords[i] <= 1.0F)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+glm::vec2 octahedralEncode(const glm::vec3& normal) {
+  float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (l1 == 0.0F) {
+    return glm::vec2(0.0F);
+  }
+  glm::vec3 n = normal / l1;
+  if (n.z >= 0.0F) {
+    return glm::vec2(n.x, n.y);
+  }
+  /* Fold the lower hemisphere over the diagonals */
+  return glm::vec2((1.0F - std::abs(n.y)) * signNotZero(n.x),
+                   (1.0F - std::abs(n.x)) * signNotZero(n.y));
+}
+
+CompactVertex packCompactVertex(const Vertex& vertex) {
+  CompactVertex packed;
+  packPosition(vertex.position, packed.position);
+  packed.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0F));
+  packTexCoords(vertex.texCoords, packed.texCoords);
+  return packed;
+}
+
+OctahedralVertex packOctahedralVertex(const Vertex& vertex) {
+  OctahedralVertex packed;
+  packPosition(vertex.position, packed.position);
+  glm::vec2 encoded = octahedralEncode(vertex.normal);
+  packed.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(encoded.x));
+  packed.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(encoded.y));
+  packTexCoords(vertex.texCoords, packed.texCoords);
+  return packed;
+}
+
+std::vector<std::byte> packVertices(const std::vector<Vertex>& vertices,
+                                    VertexFormat format) {
+  switch (format) {
+    case VertexFormat::COMPACT:
+      return packAll<CompactVertex>(vertices, packCompactVertex);
+    case VertexFormat::OCTAHEDRAL:
+      return packAll<OctahedralVertex>(vertices, packOctahedralVertex);
+    case VertexFormat::FLOAT32:
+      break;
+  }
+  std::vector<std::byte> data(vertices.size() * sizeof(Vertex));
+  std::memcpy(data.data(), vertices.data(), data.size());
+  return data;
+}
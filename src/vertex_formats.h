@@ -0,0 +1,62 @@
+#ifndef VERTEX_FORMATS_H
+#define VERTEX_FORMATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "src/vertex.h"
+#include "src/vertex_layout.h"
+
+/* GPU-side representations a Mesh can be uploaded in. Meshes are always
+   authored as Vertex, the compact formats are produced by packVertices() */
+enum class VertexFormat {
+  /* Vertex as is, 32 bytes */
+  FLOAT32,
+  /* Half positions, 10:10:10:2 snorm normals, unorm16 UVs, 16 bytes.
+     Decodes to the same attributes as FLOAT32, so any shader works */
+  COMPACT,
+  /* Like COMPACT, but normals are octahedral-encoded in 2x snorm16 for
+     better precision. Needs a shader built with OCT_NORMALS defined, see
+     shaders/octahedral_incl.vert */
+  OCTAHEDRAL,
+};
+
+struct CompactVertex {
+  /* xyz as half floats, w is padding to keep the normal aligned */
+  uint16_t position[4];
+  /* GL_INT_2_10_10_10_REV */
+  uint32_t normal;
+  uint16_t texCoords[2];
+
+  static const VertexLayout& layout();
+};
+
+struct OctahedralVertex {
+  uint16_t position[4];
+  int16_t normal[2];
+  uint16_t texCoords[2];
+
+  static const VertexLayout& layout();
+};
+
+const VertexLayout& vertexFormatLayout(VertexFormat format);
+
+/* Whether the vertices survive quantization: UVs have to lie in [0, 1] and
+   positions within half-float range */
+bool fitsCompactFormat(const std::vector<Vertex>& vertices);
+
+/* Maps a unit vector onto the [-1, 1]^2 octahedron */
+glm::vec2 octahedralEncode(const glm::vec3& normal);
+
+CompactVertex packCompactVertex(const Vertex& vertex);
+OctahedralVertex packOctahedralVertex(const Vertex& vertex);
+
+/* Converts vertices into the buffer contents for the given format. Pure CPU,
+   so it can also be used to convert meshes offline */
+std::vector<std::byte> packVertices(const std::vector<Vertex>& vertices,
+                                    VertexFormat format);
+
+#endif /* VERTEX_FORMATS_H */
@@ -0,0 +1,54 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+struct VertexAttribute {
+  GLuint location;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  size_t offset;
+};
+
+/* Describes how one vertex type is laid out in an interleaved buffer.
+   Every vertex struct exposes a static layout() returning one of these */
+struct VertexLayout {
+  GLsizei stride;
+  std::vector<VertexAttribute> attributes;
+
+  /* Points the attributes at the buffer bound to GL_ARRAY_BUFFER */
+  void enable() const {
+    for (const VertexAttribute& attribute : attributes) {
+      glEnableVertexAttribArray(attribute.location);
+      glVertexAttribPointer(attribute.location, attribute.size, attribute.type,
+                            attribute.normalized, stride,
+                            (void*)attribute.offset);
+    }
+  }
+};
+
+/* glBindVertexArray that skips redundant binds. Every VAO bind and delete
+   has to go through here for the cached binding to stay correct */
+inline void bindVertexArray(GLuint vao) {
+  static GLuint bound = 0;
+  if (vao != bound) {
+    glBindVertexArray(vao);
+    bound = vao;
+  }
+}
+
+inline void deleteVertexArray(GLuint vao) {
+  bindVertexArray(0);
+  glDeleteVertexArrays(1, &vao);
+}
+
+template <typename V>
+const VertexLayout& vertexLayout() {
+  return V::layout();
+}
+
+#endif /* VERTEX_LAYOUT_H */
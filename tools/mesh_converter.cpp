@@ -0,0 +1,59 @@
+#include <iostream>
+#include <optional>
+
+#include <cxxopts.hpp>
+#include <magic_enum/magic_enum.hpp>
+
+#include "src/logger.h"
+#include "src/mesh_cache.h"
+#include "src/mesh_cooker.h"
+
+/* Converts OBJ models into .meshcache files ahead of time, so
+   ResourceManager::loadModel maps them instead of importing on first
+   run */
+int main(int argc, char* argv[]) {
+  cxxopts::Options options("mesh_converter",
+                           "Converts OBJ models into mesh caches");
+
+  options.add_options()(
+      "f,format", "FLOAT32, COMPACT or OCTAHEDRAL; must match the format "
+                  "the model is loaded with",
+      cxxopts::value<std::string>()->default_value("COMPACT"))(
+      "input", "Source model", cxxopts::value<std::string>())(
+      "h,help", "Print usage");
+  options.parse_positional({"input"});
+
+  cxxopts::ParseResult result = options.parse(argc, argv);
+
+  if (result.count("help") || !result.count("input")) {
+    std::cout << options.help() << std::endl;
+    return result.count("help") ? 0 : 1;
+  }
+
+  std::optional<VertexFormat> format = magic_enum::enum_cast<VertexFormat>(
+      result["format"].as<std::string>());
+  if (!format) {
+    LOG_ERROR("Unknown format ", result["format"].as<std::string>());
+    return 1;
+  }
+
+  std::filesystem::path input = result["input"].as<std::string>();
+  try {
+    MeshCacheKey key = MeshCache::keyFor(input, *format);
+    CookedMesh cooked =
+        cookMesh(input.stem().string(), loadObj(input), key.format);
+    /* Unlike loadModel, a failed write is fatal here */
+    MeshCache::write(MeshCache::pathFor(input), key, cooked.data);
+
+    size_t rawBytes = cooked.data.verticesCount * sizeof(Vertex) +
+                      cooked.data.indicesCount * sizeof(unsigned int);
+    LOG_INFO("Converted ", input, " into ", MeshCache::pathFor(input), " as ",
+             magic_enum::enum_name(cooked.data.format), ", ",
+             cooked.vertexData.size() + cooked.indexData.size(),
+             " bytes (", rawBytes, " bytes unpacked)");
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return 1;
+  }
+  return 0;
+}
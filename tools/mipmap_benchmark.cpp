@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <cxxopts.hpp>
+#include <stb_image.h>
+
+#include "src/logger.h"
+#include "src/mipmap_generator.h"
+
+/* Compares generateMipChain against the driver's glGenerateMipmap on the
+   same image. Both sides include the upload of every level they produce. */
+
+static double averageMs(int iterations, const std::function<void()>& run) {
+  run(); /* warm-up: page faults, lazy tables, driver shader compiles */
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    run();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options options("mipmap_benchmark",
+                           "CPU mip generation against glGenerateMipmap");
+
+  options.add_options()("s,size", "Side of the generated test image",
+                        cxxopts::value<int>()->default_value("2048"))(
+      "i,iterations", "Runs per measurement",
+      cxxopts::value<int>()->default_value("10"))(
+      "input", "Image to use instead of noise", cxxopts::value<std::string>())(
+      "h,help", "Print usage");
+  options.parse_positional({"input"});
+
+  cxxopts::ParseResult result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  int iterations = result["iterations"].as<int>();
+
+  int width = result["size"].as<int>();
+  int height = width;
+  int channels = 4;
+  std::vector<unsigned char> pixels;
+  if (result.count("input")) {
+    std::string input = result["input"].as<std::string>();
+    unsigned char* data = stbi_load(input.c_str(), &width, &height, &channels,
+                                    0);
+    if (!data) {
+      LOG_ERROR("Failed to load ", input, ": ", stbi_failure_reason());
+      return 1;
+    }
+    pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+    stbi_image_free(data);
+  } else {
+    pixels.resize(static_cast<size_t>(width) * height * channels);
+    std::mt19937 random(42);
+    for (unsigned char& value : pixels) {
+      value = static_cast<unsigned char>(random());
+    }
+  }
+  GLenum format = channels == 4 ? GL_RGBA
+                  : channels == 3 ? GL_RGB
+                  : channels == 2 ? GL_RG
+                                  : GL_RED;
+
+  if (!glfwInit()) {
+    LOG_ERROR("glfwInit failed");
+    return 1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+  if (window == nullptr) {
+    LOG_ERROR("Window creation failed");
+    glfwTerminate();
+    return 1;
+  }
+  glfwMakeContextCurrent(window);
+  if (glewInit() != GLEW_OK) {
+    LOG_ERROR("glewInit failed");
+    glfwTerminate();
+    return 1;
+  }
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  auto uploadChain = [&](const MipChain& chain) {
+    for (size_t level = 0; level < chain.levels.size(); level++) {
+      const MipLevel& mip = chain.levels[level];
+      glTexImage2D(GL_TEXTURE_2D, level, format, mip.width, mip.height, 0,
+                   format, GL_UNSIGNED_BYTE, chain.data.data() + mip.offset);
+    }
+    glFinish();
+  };
+
+  auto cpu = [&](MipFilter filter, bool srgb, bool parallel) {
+    MipChainOptions mipOptions;
+    mipOptions.filter = filter;
+    mipOptions.srgb = srgb;
+    mipOptions.parallel = parallel;
+    return averageMs(iterations, [&]() {
+      uploadChain(generateMipChain(pixels.data(), width, height, channels,
+                                   mipOptions));
+    });
+  };
+
+  double gpu = averageMs(iterations, [&]() {
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+                 GL_UNSIGNED_BYTE, pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish();
+  });
+
+  std::cout << "Image " << width << "x" << height << ", " << channels
+            << " channels, " << iterations << " iterations\n"
+            << "Renderer: " << glGetString(GL_RENDERER) << "\n\n"
+            << "glGenerateMipmap            " << gpu << " ms\n"
+            << "box, linear, 1 thread       "
+            << cpu(MipFilter::BOX, false, false) << " ms\n"
+            << "box, sRGB, 1 thread         "
+            << cpu(MipFilter::BOX, true, false) << " ms\n"
+            << "box, sRGB, thread pool      "
+            << cpu(MipFilter::BOX, true, true) << " ms\n"
+            << "kaiser, sRGB, 1 thread      "
+            << cpu(MipFilter::KAISER, true, false) << " ms\n"
+            << "kaiser, sRGB, thread pool   "
+            << cpu(MipFilter::KAISER, true, true) << " ms" << std::endl;
+
+  glDeleteTextures(1, &texture);
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <optional>
+
+#include <cxxopts.hpp>
+#include <magic_enum/magic_enum.hpp>
+#include <stb_image.h>
+
+#include "src/logger.h"
+#include "src/texture_container.h"
+#include "src/texture_cooker.h"
+
+/* Converts source images into block-compressed .ctex containers with
+   precomputed mip chains, loadable through ResourceManager::loadTexture */
+int main(int argc, char* argv[]) {
+  cxxopts::Options options("texture_cooker",
+                           "Compresses images into .ctex textures");
+
+  options.add_options()("f,format",
+                        "BC1, BC3, BC4 or BC5; picked from the channel count "
+                        "when omitted",
+                        cxxopts::value<std::string>())(
+      "filter", "Mip filter, BOX or KAISER",
+      cxxopts::value<std::string>()->default_value("KAISER"))(
+      "linear", "Data is not sRGB color (normal, specular, masks)")(
+      "o,output", "Output path, defaults to <input>.ctex",
+      cxxopts::value<std::string>())("input", "Source image",
+                                     cxxopts::value<std::string>())(
+      "h,help", "Print usage");
+  options.parse_positional({"input"});
+
+  cxxopts::ParseResult result = options.parse(argc, argv);
+
+  if (result.count("help") || !result.count("input")) {
+    std::cout << options.help() << std::endl;
+    return result.count("help") ? 0 : 1;
+  }
+
+  std::filesystem::path input = result["input"].as<std::string>();
+  std::filesystem::path output = input;
+  output.replace_extension(TEXTURE_CONTAINER_EXTENSION);
+  if (result.count("output")) {
+    output = result["output"].as<std::string>();
+  }
+
+  /* Same orientation as textures decoded at runtime */
+  stbi_set_flip_vertically_on_load(true);
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  unsigned char* pixels =
+      stbi_load(input.c_str(), &width, &height, &channels, 0);
+  if (!pixels) {
+    LOG_ERROR("Failed to load ", input, ": ", stbi_failure_reason());
+    return 1;
+  }
+
+  TextureCompression format = defaultCompression(channels);
+  if (result.count("format")) {
+    std::optional<TextureCompression> requested =
+        magic_enum::enum_cast<TextureCompression>(
+            result["format"].as<std::string>());
+    if (!requested) {
+      LOG_ERROR("Unknown format ", result["format"].as<std::string>());
+      stbi_image_free(pixels);
+      return 1;
+    }
+    format = *requested;
+  }
+
+  MipChainOptions mipOptions;
+  mipOptions.srgb = !result.count("linear");
+  std::optional<MipFilter> filter = magic_enum::enum_cast<MipFilter>(
+      result["filter"].as<std::string>());
+  if (!filter) {
+    LOG_ERROR("Unknown filter ", result["filter"].as<std::string>());
+    stbi_image_free(pixels);
+    return 1;
+  }
+  mipOptions.filter = *filter;
+
+  CompressedTexture texture =
+      cookTexture(pixels, width, height, channels, format, mipOptions);
+  stbi_image_free(pixels);
+
+  try {
+    writeTextureContainer(output, texture);
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return 1;
+  }
+
+  size_t sourceBytes = static_cast<size_t>(width) * height * channels;
+  LOG_INFO("Cooked ", input, " (", width, "x", height, ", ", channels,
+           " channels) into ", output, " as ", magic_enum::enum_name(format),
+           ", ", texture.levels.size(), " levels, ", texture.data.size(),
+           " bytes (level 0 was ", sourceBytes, " bytes raw)");
+  return 0;
+}